@@ -19,8 +19,10 @@ $boostDir = "/mnt/programmieren/current_boost"
 def configureBase()
   compilerConfig = $build.makeNewConfig("CompileTaskCPP")
   compilerConfig.clear()
-  compilerConfig["compiler.cFlags"] = " -Wall -Werror -fexceptions"
+  compilerConfig["compiler.cFlags"] = " -std=c++20 -Wall -Werror -fexceptions"
   compilerConfig["compiler.includePaths"] = " -I#{$localDir}/src -I#{$eigenDir} -I#{$boostDir}"
+  compilerConfig["linker.libPaths"] = " -L#{$boostDir}/stage/lib"
+  compilerConfig["linker.libs"] = " -lboost_thread -lboost_system -lpthread"
 end
 
 
@@ -109,6 +111,14 @@ def buildIt()
 
     myLibTask = Makr.makeStaticLib($buildDir + "/libuenf-common.a", $build, tasks, $build.getConfig("CompileTaskCPP"))
 
+    # the microbenchmarks (see bench/Benchmark.h) are only built on request, they link against the lib:
+    #   ruby Makrfile.rb Release bench && Release/uenf-bench --json current.json --baseline baseline.json
+    if($target == "bench")
+      allBenchFiles = Makr::FileCollector.collect($localDir + "/bench/", "*.{cpp,cxx}", true)
+      benchTasks = Makr.applyGenerators(allBenchFiles, [Makr::CompileTaskGenerator.new($build, $build.getConfig("CompileTaskCPP"))])
+      Makr.makeProgram($buildDir + "/uenf-bench", $build, benchTasks + [myLibTask], $build.getConfig("CompileTaskCPP"))
+    end
+
     $build.build()
   end  
 end
@@ -0,0 +1,195 @@
+#include "Benchmark.h"
+
+#include <uenf/AsyncIO.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  enum { fileBytes = 64 << 20, blockBytes = 4096, blocks = fileBytes / blockBytes, queueDepth = 128 };
+
+  char const * const fileName = "/tmp/uenf-bench-asyncio.bin";
+
+
+  // 64 MiB file, the reads hit the page cache, so the numbers are the overhead per request, not the device
+  void createFile()
+  {
+    static bool created = false;
+    if(created)
+      return;
+    std::vector<char> block(blockBytes, 'x');
+    std::ofstream file(fileName, std::ios::binary);
+    for(int i = 0; i < blocks; ++i)
+      file.write(&block[0], blockBytes);
+    created = true;
+  }
+
+  std::size_t blockOf(std::size_t i) { return (i * 7919) % blocks; }
+
+
+  void blockingPread(std::size_t iterations)
+  {
+    createFile();
+    int const fd = ::open(fileName, O_RDONLY);
+    std::vector<char> buffer(blockBytes);
+    for(std::size_t i = 0; i < iterations; ++i)
+      Bench::doNotOptimize(::pread(fd, &buffer[0], blockBytes, off_t(blockOf(i) * blockBytes)));
+    ::close(fd);
+  }
+
+
+  /* queueDepth chains of reads, each completion issues the next read of its chain, so there are always queueDepth
+     requests in flight until all iterations are issued
+  */
+  class ReadChains
+  {
+  public:
+    ReadChains(IOEngine & engineArg, std::size_t iterationsArg, char * buffersArg):engine(engineArg),
+      file(engine, fileName), iterations(iterationsArg), buffers(buffersArg), issued(0), completed(0) {}
+
+    void run()
+    {
+      {
+        IOEngine::Batch batch(engine);
+        for(int chain = 0; chain < queueDepth; ++chain)
+          next(chain);
+      }
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while(completed < iterations)
+        done.wait(lock);
+    }
+
+  private:
+    void next(int chain)
+    {
+      std::size_t i;
+      {
+        boost::lock_guard<boost::mutex> guard(mutex);
+        if(issued == iterations)
+          return;
+        i = issued++;
+      }
+      file.read(buffers + chain * blockBytes, blockBytes, blockOf(i) * blockBytes,
+                [this, chain](Expected<std::size_t> const &) { next(chain); finished(); });
+    }
+
+    void finished()
+    {
+      boost::lock_guard<boost::mutex> guard(mutex);
+      if(++completed == iterations)
+        done.notify_all();
+    }
+
+    IOEngine & engine;
+    AsyncFile file;
+    std::size_t const iterations;
+    char * const buffers;
+    std::size_t issued, completed;
+    boost::mutex mutex;
+    boost::condition_variable done;
+  };
+
+
+  void chainedReads(std::size_t iterations, IOEngine::Backend backend, bool registered)
+  {
+    createFile();
+    static std::vector<char> buffers(queueDepth * blockBytes);
+    IOEngine engine(queueDepth, backend);
+    if(registered)
+    {
+      void * buffer = &buffers[0];
+      std::size_t const size = buffers.size();
+      engine.registerBuffers(&buffer, &size, 1);
+    }
+    ReadChains(engine, iterations, &buffers[0]).run();
+  }
+
+  void uring(std::size_t iterations)           { chainedReads(iterations, IOEngine::ioUring, false); }
+  void uringRegistered(std::size_t iterations) { chainedReads(iterations, IOEngine::ioUring, true); }
+  void pool(std::size_t iterations)            { chainedReads(iterations, IOEngine::threadPool, false); }
+
+
+  /* batches of four times the queue depth, so the issuing thread has to wait for free slots within each batch
+     (and the deferred requests must be submitted for that), the contents of the buffers are not used
+  */
+  void batchedReads(std::size_t iterations, IOEngine::Backend backend)
+  {
+    createFile();
+    static std::vector<char> buffers(queueDepth * blockBytes);
+    IOEngine engine(queueDepth, backend);
+    AsyncFile file(engine, fileName);
+    for(std::size_t begin = 0; begin < iterations; begin += 4 * queueDepth)
+    {
+      IOEngine::Batch batch(engine);
+      for(std::size_t i = begin; i < std::min<std::size_t>(iterations, begin + 4 * queueDepth); ++i)
+        file.read(&buffers[(i % queueDepth) * blockBytes], blockBytes, blockOf(i) * blockBytes,
+                  [](Expected<std::size_t> const &) {});
+    }
+    engine.drain();
+  }
+
+  void uringBatched(std::size_t iterations) { batchedReads(iterations, IOEngine::ioUring); }
+  void poolBatched(std::size_t iterations)  { batchedReads(iterations, IOEngine::threadPool); }
+
+
+#ifdef UENF_ASYNCIO_COROUTINES
+  struct Completion
+  {
+    Completion():count(0) {}
+    boost::mutex mutex;
+    boost::condition_variable done;
+    int count;
+  };
+
+  DetachedTask readSequence(AsyncFile & file, char * buffer, std::size_t begin, std::size_t end, std::size_t step,
+                            Completion & completion)
+  {
+    for(std::size_t i = begin; i < end; i += step)
+      co_await file.read(buffer, blockBytes, blockOf(i) * blockBytes);
+    boost::lock_guard<boost::mutex> guard(completion.mutex);
+    ++completion.count;
+    completion.done.notify_all();
+  }
+
+  // queueDepth coroutines reading in a loop, so again queueDepth requests in flight
+  void coroutines(std::size_t iterations)
+  {
+    createFile();
+    static std::vector<char> buffers(queueDepth * blockBytes);
+    IOEngine engine(queueDepth, IOEngine::ioUring);
+    AsyncFile file(engine, fileName);
+    Completion completion;
+    for(int c = 0; c < queueDepth; ++c)
+      readSequence(file, &buffers[c * blockBytes], c, iterations, queueDepth, completion);
+    boost::unique_lock<boost::mutex> lock(completion.mutex);
+    while(completion.count < queueDepth)
+      completion.done.wait(lock);
+  }
+#endif
+
+
+  Bench::Registrar r1("AsyncIO/read 4 KiB/blocking pread",                       &blockingPread);
+  Bench::Registrar r2("AsyncIO/read 4 KiB/io_uring, 128 in flight",              &uring);
+  Bench::Registrar r3("AsyncIO/read 4 KiB/io_uring, registered buffers",         &uringRegistered);
+  Bench::Registrar r4("AsyncIO/read 4 KiB/thread pool, 128 in flight",           &pool);
+  Bench::Registrar r6("AsyncIO/read 4 KiB/io_uring, 512 per Batch",              &uringBatched);
+  Bench::Registrar r7("AsyncIO/read 4 KiB/thread pool, 512 per Batch",           &poolBatched);
+#ifdef UENF_ASYNCIO_COROUTINES
+  Bench::Registrar r5("AsyncIO/read 4 KiB/io_uring, coroutines, 128 in flight",  &coroutines);
+#endif
+
+}  // end of anonymous namespace
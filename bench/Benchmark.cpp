@@ -0,0 +1,374 @@
+#include "Benchmark.h"
+
+#include <boost/exception/diagnostic_information.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <ciso646>
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+  #include <unistd.h>
+#endif
+
+
+namespace uenf
+{
+
+namespace Bench
+{
+
+
+namespace
+{
+
+  struct Case
+  {
+    std::string name;
+    Body body;
+  };
+
+  struct Result
+  {
+    std::string name;
+    std::size_t iterations;
+    std::vector<double> samples; // nanoseconds per iteration, sorted
+    double median, max, mean, stddev; // of the samples, each the mean time per iteration of its run
+    std::vector<std::string> notes;
+  };
+
+  struct Options
+  {
+    Options():samples(20), sampleSeconds(0.02), cpu(0), threshold(10.0), list(false) {}
+    std::size_t samples;
+    double sampleSeconds;
+    int cpu; // -1: no pinning, else the index among the allowed cpus
+    std::string jsonFile;
+    std::string baselineFile;
+    double threshold;
+    bool list;
+    std::string filter;
+  };
+
+
+  // function local, as cases register during static initialization of other translation units
+  std::vector<Case> & getCases()
+  {
+    static std::vector<Case> cases;
+    return cases;
+  }
+
+
+  std::vector<std::string> & getNotes()
+  {
+    static std::vector<std::string> notes;
+    return notes;
+  }
+
+
+  double pausedSeconds = 0.0; // of the running sample, only touched by the measuring thread
+
+
+  double seconds()
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+
+#ifdef __linux__
+  cpu_set_t allowedCpus; // at startup
+
+  void pinCurrentThread(int index)
+  {
+    sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus);
+    if(index < 0)
+      return;
+    for(int cpu = 0, allowed = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if(CPU_ISSET(cpu, &allowedCpus) and allowed++ == index)
+      {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if(pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0)
+          std::cout << "pinned to cpu " << cpu << std::endl;
+        return;
+      }
+    }
+    std::cerr << "cpu index " << index << " not available, not pinned" << std::endl;
+  }
+#else
+  void pinCurrentThread(int) {}
+#endif
+
+
+  double runSeconds(Body const & body, std::size_t iterations)
+  {
+    getNotes().clear();
+    pausedSeconds = 0.0;
+    double const start = seconds();
+    body(iterations);
+    return seconds() - start - pausedSeconds;
+  }
+
+
+  //! the warm-up: grows the iteration count until a run takes at least sampleSeconds, returns that count
+  std::size_t calibrate(Body const & body, double sampleSeconds)
+  {
+    std::size_t iterations = 1;
+    while(true)
+    {
+      double const s = runSeconds(body, iterations);
+      if(s >= sampleSeconds or iterations >= (std::size_t(1) << 40))
+        return iterations;
+      iterations *= s > sampleSeconds / 100.0 ? std::size_t(sampleSeconds / s * 1.2) + 1 : 10;
+    }
+  }
+
+
+  Result measure(Case const & c, Options const & options)
+  {
+    runSeconds(c.body, 1); // lets cases build their fixtures lazily outside the measurement
+    Result result;
+    result.name = c.name;
+    result.iterations = calibrate(c.body, options.sampleSeconds);
+    for(std::size_t s = 0; s < options.samples; ++s)
+      result.samples.push_back(runSeconds(c.body, result.iterations) * 1e9 / double(result.iterations));
+    result.notes = getNotes();
+
+    std::vector<double> & v = result.samples;
+    std::sort(v.begin(), v.end());
+    std::size_t const n = v.size();
+    result.median = n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+    result.max = v.back();
+    result.mean = 0.0;
+    for(std::size_t i = 0; i < n; ++i)
+      result.mean += v[i] / double(n);
+    double squares = 0.0;
+    for(std::size_t i = 0; i < n; ++i)
+      squares += (v[i] - result.mean) * (v[i] - result.mean);
+    result.stddev = n > 1 ? std::sqrt(squares / double(n - 1)) : 0.0;
+    return result;
+  }
+
+
+  std::string jsonString(std::string const & s)
+  {
+    std::string out("\"");
+    for(std::size_t i = 0; i < s.size(); ++i)
+    {
+      if(s[i] == '"' or s[i] == '\\')
+        out += '\\';
+      out += s[i];
+    }
+    return out + '"';
+  }
+
+
+  //! one case per line, so readBaseline() does not need a full JSON parser
+  void writeJson(std::string const & fileName, std::vector<Result> const & results, Options const & options)
+  {
+    std::ofstream file(fileName.c_str());
+    if(not file)
+      throw std::runtime_error("cannot write " + fileName);
+    char host[256] = "unknown";
+#ifdef __linux__
+    gethostname(host, sizeof(host) - 1);
+#endif
+    file << std::setprecision(6) << "{\n  \"host\": " << jsonString(host) << ", \"samples\": " << options.samples
+         << ", \"sample_seconds\": " << options.sampleSeconds << ", \"cpu\": " << options.cpu << ",\n  \"cases\": [\n";
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+      Result const & r = results[i];
+      file << "    {\"name\": " << jsonString(r.name) << ", \"median_ns\": " << r.median << ", \"max_ns\": " << r.max
+           << ", \"mean_ns\": " << r.mean << ", \"stddev_ns\": " << r.stddev << ", \"min_ns\": " << r.samples.front()
+           << ", \"iterations\": " << r.iterations << ", \"notes\": [";
+      for(std::size_t n = 0; n < r.notes.size(); ++n)
+        file << (n ? ", " : "") << jsonString(r.notes[n]);
+      file << "]}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    file << "  ]\n}\n";
+  }
+
+
+  //! the medians by name of a file written by writeJson()
+  std::map<std::string, double> readBaseline(std::string const & fileName)
+  {
+    std::ifstream file(fileName.c_str());
+    if(not file)
+      throw std::runtime_error("cannot read " + fileName);
+    std::map<std::string, double> medians;
+    std::string line;
+    while(std::getline(file, line))
+    {
+      std::string::size_type const nameKey = line.find("\"name\": \"");
+      std::string::size_type const medianKey = line.find("\"median_ns\": ");
+      if(nameKey == std::string::npos or medianKey == std::string::npos)
+        continue;
+      std::string name;
+      std::string::size_type i = nameKey + 9;
+      for(; i < line.size() and line[i] not_eq '"'; ++i)
+        name += line[i] == '\\' ? line[++i] : line[i];
+      medians[name] = std::atof(line.c_str() + medianKey + 13);
+    }
+    return medians;
+  }
+
+
+  Options parseOptions(int argc, char * argv[])
+  {
+    Options options;
+    for(int i = 1; i < argc; ++i)
+    {
+      std::string const arg(argv[i]);
+      bool const hasValue = i + 1 < argc;
+      if(arg == "--samples" and hasValue)          options.samples = std::max(1, std::atoi(argv[++i]));
+      else if(arg == "--sample-time" and hasValue) options.sampleSeconds = std::atof(argv[++i]);
+      else if(arg == "--cpu" and hasValue)         options.cpu = std::atoi(argv[++i]);
+      else if(arg == "--json" and hasValue)        options.jsonFile = argv[++i];
+      else if(arg == "--baseline" and hasValue)    options.baselineFile = argv[++i];
+      else if(arg == "--threshold" and hasValue)   options.threshold = std::atof(argv[++i]);
+      else if(arg == "--list")                     options.list = true;
+      else if(arg.compare(0, 2, "--") == 0)        throw std::runtime_error("unknown option " + arg + ", see Benchmark.h");
+      else                                         options.filter = arg;
+    }
+    return options;
+  }
+
+}  // end of anonymous namespace
+
+
+
+void registerCase(std::string const & name, Body const & body)
+{
+  Case c;
+  c.name = name;
+  c.body = body;
+  getCases().push_back(c);
+}
+
+
+
+void note(std::string const & text)
+{
+  getNotes().push_back(text);
+}
+
+
+
+Pause::Pause():start(seconds())
+{
+}
+
+
+
+Pause::~Pause()
+{
+  pausedSeconds += seconds() - start;
+}
+
+
+
+void unpinCurrentThread()
+{
+#ifdef __linux__
+  pthread_setaffinity_np(pthread_self(), sizeof(allowedCpus), &allowedCpus);
+#endif
+}
+
+
+
+int run(int argc, char * argv[])
+{
+  Options const options = parseOptions(argc, argv);
+  std::vector<Case> const & cases = getCases();
+
+  if(options.list)
+  {
+    for(std::size_t i = 0; i < cases.size(); ++i)
+      std::cout << cases[i].name << '\n';
+    return 0;
+  }
+
+  std::map<std::string, double> baseline;
+  if(not options.baselineFile.empty())
+    baseline = readBaseline(options.baselineFile);
+
+  pinCurrentThread(options.cpu);
+
+  std::cout << std::left << std::setw(56) << "case" << std::right << std::setw(12) << "median ns" << std::setw(12)
+            << "max ns" << std::setw(10) << "stddev" << (baseline.empty() ? "" : "   vs baseline") << std::endl;
+
+  std::vector<Result> results;
+  std::size_t regressions = 0;
+  for(std::size_t i = 0; i < cases.size(); ++i)
+  {
+    if(cases[i].name.find(options.filter) == std::string::npos)
+      continue;
+    Result const r = measure(cases[i], options);
+    results.push_back(r);
+
+    std::cout << std::left << std::setw(56) << r.name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << r.median << std::setw(12) << r.max << std::setw(9)
+              << std::setprecision(1) << (r.median > 0.0 ? 100.0 * r.stddev / r.median : 0.0) << '%';
+    std::map<std::string, double>::const_iterator const b = baseline.find(r.name);
+    if(b not_eq baseline.end() and b->second > 0.0)
+    {
+      double const change = 100.0 * (r.median - b->second) / b->second;
+      std::cout << std::setw(11) << std::showpos << change << '%' << std::noshowpos;
+      if(change > options.threshold)
+      {
+        std::cout << "  REGRESSION";
+        ++regressions;
+      }
+    }
+    std::cout << std::endl;
+    for(std::size_t n = 0; n < r.notes.size(); ++n)
+      std::cout << "    " << r.notes[n] << std::endl;
+  }
+
+  if(not options.jsonFile.empty())
+    writeJson(options.jsonFile, results, options);
+
+  if(regressions)
+  {
+    std::cout << regressions << " case(s) slower than the baseline by more than " << options.threshold << '%'
+              << std::endl;
+    return 2;
+  }
+  return 0;
+}
+
+
+
+}  // end of namespace Bench
+
+}  // end of namespace uenf
+
+
+
+
+
+
+int main(int argc, char * argv[])
+{
+  try
+  {
+    return uenf::Bench::run(argc, argv);
+  }
+  catch(...)
+  {
+    std::cerr << boost::current_exception_diagnostic_information() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,118 @@
+#ifndef UENF_BENCHMARK_H
+#define UENF_BENCHMARK_H
+
+
+#include <boost/function.hpp>
+
+#include <string>
+#include <cstddef>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  Microbenchmark harness of the uenf-bench executable (built by the Makrfile with the target "bench"). A case is a
+  function running its operation "iterations" times. The harness first grows the number of iterations until a run
+  takes long enough to be measured (these runs are the warm-up), then takes a number of samples with that count and
+  reports median, maximum and standard deviation of the samples. A sample is the mean time per iteration of one
+  run, so the maximum is the slowest run, not a tail latency of single iterations (cases measuring latencies
+  report their distribution with note()). Cases register themselves at static initialization:
+
+    namespace
+    {
+      void copyString(std::size_t iterations)
+      {
+        std::string s("some text");
+        for(std::size_t i = 0; i < iterations; ++i)
+          Bench::doNotOptimize(std::string(s));
+      }
+
+      Bench::Registrar copyStringRegistrar("string/copy", &copyString);
+    }
+
+  Usage: uenf-bench [options] [name filter]
+
+    --samples n        samples per case (default 20)
+    --sample-time s    seconds per sample (default 0.02)
+    --cpu n            pins the measuring thread to cpu n (default: the first allowed cpu, -1 disables)
+    --json file        writes the results as JSON
+    --baseline file    compares the medians with those of an earlier --json output, exits with 2 if a case
+                       got slower than the threshold
+    --threshold p      regression threshold in percent (default 10)
+    --list             lists the cases
+*/
+namespace Bench
+{
+
+
+
+
+typedef boost::function<void (std::size_t iterations)> Body;
+
+void registerCase(std::string const & name, Body const & body);
+
+
+
+/*! Reports an additional result of the running case (like a latency distribution), printed below its time per
+    iteration. Only the notes of the last sample of a case are kept.
+*/
+void note(std::string const & text);
+
+
+
+//! excludes its life time from the time of the running sample (for setup and teardown inside the loop of a case)
+class Pause
+{
+public:
+  Pause();
+  ~Pause();
+private:
+  Pause(Pause const &);
+  Pause & operator=(Pause const &);
+  double const start;
+};
+
+
+
+/*! Threads inherit the pinning of the measuring thread, threads started by a case call this first to run on all
+    cpus the process was allowed to use at startup. Threads started inside the library (trace flusher, timer and
+    I/O completion threads) stay on the cpu of the measuring thread, use --cpu -1 to measure them spread out.
+*/
+void unpinCurrentThread();
+
+
+
+struct Registrar
+{
+  Registrar(std::string const & name, Body const & body) { registerCase(name, body); }
+};
+
+
+
+//! keeps the compiler from optimizing away the computation of value
+template<typename T> inline void doNotOptimize(T const & value)
+{
+#if defined(__GNUC__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static_cast<void>(*static_cast<char const volatile *>(static_cast<void const *>(&value)));
+#endif
+}
+
+
+
+
+} // end of namespace Bench
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,65 @@
+#include "Benchmark.h"
+
+#include <uenf/EventLoop.h>
+
+#include <ciso646>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  // the loop is processed from the benchmark thread, so no thread switches end up in the samples
+  class Loop : public EventLoop
+  {
+  public:
+    ~Loop() { stopAndWaitForThreadToExit(); }
+    using EventLoop::processEvents;
+  };
+
+
+  enum { batchSize = 64 };
+
+
+  // posting alone, the events are processed in batches outside of the sample
+  void post(std::size_t iterations)
+  {
+    Loop loop;
+    int sum = 0;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      loop.postEvent([&sum]() { ++sum; });
+      if(i % batchSize == batchSize - 1)
+      {
+        Bench::Pause pause;
+        loop.processEvents();
+      }
+    }
+    Bench::Pause pause;
+    loop.processEvents();
+    Bench::doNotOptimize(sum);
+  }
+
+
+  // posting and processing, per event
+  void postProcess(std::size_t iterations)
+  {
+    Loop loop;
+    int sum = 0;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      loop.postEvent([&sum]() { ++sum; });
+      if(i % batchSize == batchSize - 1)
+        loop.processEvents();
+    }
+    loop.processEvents();
+    Bench::doNotOptimize(sum);
+  }
+
+
+  Bench::Registrar r1("EventLoop/postEvent",               &post);
+  Bench::Registrar r2("EventLoop/postEvent+processEvents", &postProcess);
+
+}  // end of anonymous namespace
@@ -0,0 +1,123 @@
+
+
+#include "Benchmark.h"
+
+#include <uenf/Exceptions.h>
+#include <uenf/Expected.h>
+
+#include <boost/bind/bind.hpp>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  // the typical routine failure: a parser failing on some named input, which the caller retries or skips
+  std::string const inputName("/var/data/frames/frame_000042.raw");
+
+  bool parseThrowing(std::size_t i)
+  {
+    if(i % 2 == 0)
+      BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::parse, inputName));
+    return true;
+  }
+
+  Expected<bool> parseExpected(std::size_t i)
+  {
+    if(i % 2 == 0)
+      return Error::makeIO(ExceptionIO::parse, inputName);
+    return true;
+  }
+
+
+
+  template<typename E> void throwCatch(E const & prototype, std::size_t iterations)
+  {
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      try
+      {
+        BOOST_THROW_EXCEPTION(E(prototype));
+      }
+      catch(E const & e)
+      {
+        Bench::doNotOptimize(e);
+      }
+    }
+  }
+
+
+  // failure path including what(), that is, when the caller also formats the message
+  template<typename E> void throwCatchWhat(E const & prototype, std::size_t iterations)
+  {
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      try
+      {
+        BOOST_THROW_EXCEPTION(E(prototype));
+      }
+      catch(E const & e)
+      {
+        Bench::doNotOptimize(e.what()[0]);
+      }
+    }
+  }
+
+
+  void parseRetryThrowing(std::size_t iterations)
+  {
+    std::size_t failures = 0;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      try
+      {
+        parseThrowing(i);
+      }
+      catch(ExceptionIO const &)
+      {
+        ++failures;
+      }
+    }
+    Bench::doNotOptimize(failures);
+  }
+
+
+  void parseRetryExpected(std::size_t iterations)
+  {
+    std::size_t failures = 0;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      Expected<bool> result = parseExpected(i);
+      if(not result)
+        ++failures;
+    }
+    Bench::doNotOptimize(failures);
+  }
+
+
+  void expectedFailure(Error const & prototype, std::size_t iterations)
+  {
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      Expected<int> result = Error(prototype);
+      Bench::doNotOptimize(result);
+    }
+  }
+
+
+  using boost::placeholders::_1;
+
+  Bench::Registrar r00("Exceptions/throw+catch/ExceptionBase",        boost::bind(&throwCatch<ExceptionBase>, ExceptionBase(), _1));
+  Bench::Registrar r01("Exceptions/throw+catch/ExceptionIO",          boost::bind(&throwCatch<ExceptionIO>, ExceptionIO(ExceptionIO::parse, inputName), _1));
+  Bench::Registrar r02("Exceptions/throw+catch/ExceptionParameter",   boost::bind(&throwCatch<ExceptionParameter>, ExceptionParameter(2), _1));
+  Bench::Registrar r03("Exceptions/throw+catch/ExceptionCode",        boost::bind(&throwCatch<ExceptionCode>, ExceptionCode("sanity check"), _1));
+  Bench::Registrar r04("Exceptions/throw+catch/ExceptionRuntime",     boost::bind(&throwCatch<ExceptionRuntime>, ExceptionRuntime("syscall"), _1));
+  Bench::Registrar r05("Exceptions/throw+catch+what/ExceptionIO",     boost::bind(&throwCatchWhat<ExceptionIO>, ExceptionIO(ExceptionIO::parse, inputName), _1));
+  Bench::Registrar r06("Exceptions/Expected failure/io",              boost::bind(&expectedFailure, Error::makeIO(ExceptionIO::parse, inputName), _1));
+  Bench::Registrar r07("Exceptions/Expected failure/parameter",       boost::bind(&expectedFailure, Error::makeParameter(2), _1));
+  Bench::Registrar r08("Exceptions/parse retry (50% failing)/throw",  &parseRetryThrowing);
+  Bench::Registrar r09("Exceptions/parse retry (50% failing)/Expected", &parseRetryExpected);
+
+}  // end of anonymous namespace
@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+
+#include <uenf/GlobalBlackboard.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  struct Calibration
+  {
+    double values[12];
+  };
+
+  typedef GlobalBlackboard<Calibration> Board;
+
+
+  //! keys "camera0".."cameraN", the board keeps growing, so the cases with more entries run later
+  std::vector<std::string> const & keys(std::size_t count)
+  {
+    static std::vector<std::string> names;
+    while(names.size() < count)
+    {
+      std::ostringstream oss;
+      oss << "camera" << names.size();
+      names.push_back(oss.str());
+      Board::set(names.back(), boost::shared_ptr<Calibration>(new Calibration));
+    }
+    return names;
+  }
+
+
+  void lookup(std::size_t iterations, std::size_t entries)
+  {
+    std::vector<std::string> const & k = keys(entries);
+    for(std::size_t i = 0; i < iterations; ++i)
+      Bench::doNotOptimize(Board::get(k[(i * 7) % entries]));
+  }
+
+
+  void miss(std::size_t iterations)
+  {
+    keys(16);
+    std::string const key("no such camera");
+    for(std::size_t i = 0; i < iterations; ++i)
+      Bench::doNotOptimize(Board::get(key));
+  }
+
+
+  //! all lookups go through one mutex, the iterations are split among the threads
+  void contended(std::size_t iterations, unsigned int threads)
+  {
+    std::vector<std::string> const & k = keys(16);
+    boost::thread_group group;
+    for(unsigned int t = 0; t < threads; ++t)
+    {
+      std::size_t const share = iterations / threads;
+      group.create_thread([&k, share]()
+      {
+        Bench::unpinCurrentThread();
+        for(std::size_t i = 0; i < share; ++i)
+          Bench::doNotOptimize(Board::get(k[i % 16]));
+      });
+    }
+    group.join_all();
+  }
+
+
+  Bench::Registrar r1("GlobalBlackboard/get/hit, 16 entries",    [](std::size_t n) { lookup(n, 16); });
+  Bench::Registrar r2("GlobalBlackboard/get/hit, 1024 entries",  [](std::size_t n) { lookup(n, 1024); });
+  Bench::Registrar r3("GlobalBlackboard/get/miss",               &miss);
+  Bench::Registrar r4("GlobalBlackboard/get/hit, 4 threads",     [](std::size_t n) { contended(n, 4); });
+
+}  // end of anonymous namespace
@@ -0,0 +1,188 @@
+#include "Benchmark.h"
+
+#include <uenf/ImageCodec.h>
+
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <ciso646>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  enum { width = 1920, height = 1080 };
+
+
+  //! a smooth gradient with a little noise, compresses about like a camera frame, alpha channels are opaque
+  void fillFrame(ImageU8 & image, unsigned int seed)
+  {
+    int const channels = image.channels();
+    int const alpha = channels == 2 or channels == 4 ? channels - 1 : -1;
+    for(int y = 0; y < image.height(); ++y)
+    {
+      unsigned char * row = image.row(y);
+      for(int x = 0; x < image.width() * channels; ++x)
+      {
+        seed = seed * 1664525u + 1013904223u;
+        int const c = x % channels;
+        row[x] = c == alpha ? 255 : (unsigned char)((x / channels + y) / 4 + c * 50 + (seed >> 29));
+      }
+    }
+  }
+
+
+  bool equal(ImageU8 const & a, ImageU8 const & b)
+  {
+    if(a.width() not_eq b.width() or a.height() not_eq b.height() or a.channels() not_eq b.channels())
+      return false;
+    for(int y = 0; y < a.height(); ++y)
+      if(a.width() and std::memcmp(a.row(y), b.row(y), std::size_t(a.width()) * a.channels()) not_eq 0)
+        return false;
+    return true;
+  }
+
+
+  /* the round trip checks of the codec (there is no test suite), run once before the first case: all channel
+     counts, sizes down to empty, several band heights, whole and band by band decoding, and truncated streams,
+     which must be rejected; a failure ends uenf-bench with the exception
+  */
+  void verifyRoundTrips()
+  {
+    static bool verified = false;
+    if(verified)
+      return;
+    Bench::Pause pause;
+    int const sizes[][2] = { {0, 0}, {7, 0}, {0, 7}, {1, 1}, {3, 5}, {61, 47}, {640, 480}, {1, 700}, {700, 1} };
+    int const bandHeights[] = { 0, 1, 7, 10000 };
+    for(std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+      for(int channels = 1; channels <= 4; ++channels)
+        for(std::size_t b = 0; b < sizeof(bandHeights) / sizeof(bandHeights[0]); ++b)
+        {
+          ImageU8 image(sizes[s][0], sizes[s][1], channels), decoded, banded;
+          fillFrame(image, unsigned(s * 16 + channels * 4 + b));
+          std::vector<unsigned char> stream;
+          ImageCodec::encode(image, stream, bandHeights[b]);
+          ImageCodec::decode(&stream[0], stream.size(), decoded);
+
+          ImageCodec::Decoder decoder(&stream[0], ImageCodec::Decoder::headerBytes(&stream[0], stream.size()));
+          decoder.prepare(banded);
+          for(int band = decoder.bandCount() - 1; band >= 0; --band)
+            decoder.decodeBand(band, &stream[decoder.bandOffset(band)], banded);
+
+          if(not equal(image, decoded) or not equal(image, banded))
+            BOOST_THROW_EXCEPTION(ExceptionRuntime("ImageCodec round trip failed"));
+
+          if(decoder.bandCount())
+            try
+            {
+              ImageCodec::decode(&stream[0], stream.size() - 1, decoded);
+              BOOST_THROW_EXCEPTION(ExceptionRuntime("ImageCodec accepted a truncated stream"));
+            }
+            catch(ExceptionIO const &)
+            {
+            }
+        }
+    verified = true;
+  }
+
+
+  struct Fixture
+  {
+    explicit Fixture(int channels):frame(width, height, channels), copy(width, height, channels)
+    {
+      verifyRoundTrips();
+      fillFrame(frame, 1);
+      singleBand.resize(ImageCodec::maxEncodedBytes(width, height, channels, height));
+      singleBand.resize(ImageCodec::encode(frame, &singleBand[0], singleBand.size(), height));
+      bands.resize(ImageCodec::maxEncodedBytes(width, height, channels));
+      bands.resize(ImageCodec::encode(frame, &bands[0], bands.size()));
+      ImageCodec::decode(&bands[0], bands.size(), copy);
+      if(not equal(frame, copy))
+        BOOST_THROW_EXCEPTION(ExceptionRuntime("ImageCodec round trip failed"));
+    }
+
+    std::size_t pixelBytes() const { return std::size_t(width) * height * frame.channels(); }
+
+    ImageU8 frame;
+    ImageU8 copy;
+    std::vector<unsigned char> singleBand;
+    std::vector<unsigned char> bands;
+  };
+
+  Fixture & fixture(int channels)
+  {
+    static Fixture * fixtures[5] = {};
+    if(not fixtures[channels])
+      fixtures[channels] = new Fixture(channels);
+    return *fixtures[channels];
+  }
+
+
+  //! runs operation iterations times and notes the throughput in pixel bytes (and the size of the stream)
+  template<typename Operation> void throughput(std::size_t iterations, Fixture const & f, std::size_t streamBytes,
+                                               Operation operation)
+  {
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; ++i)
+      operation();
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::ostringstream oss;
+    oss.precision(3);
+    oss << double(f.pixelBytes()) * double(iterations) / seconds / 1e6 << " MB/s of pixels";
+    if(streamBytes)
+      oss << ", stream " << 100.0 * double(streamBytes) / double(f.pixelBytes()) << "% of the pixels";
+    Bench::note(oss.str());
+  }
+
+
+  void copy(std::size_t iterations, int channels)
+  {
+    Fixture & f = fixture(channels);
+    throughput(iterations, f, 0, [&f]() { f.copy.copyFrom(f.frame); });
+  }
+
+
+  // a single band does not parallelize, the difference to the banded cases is what the bands buy
+  void encode(std::size_t iterations, int channels, bool banded)
+  {
+    Fixture & f = fixture(channels);
+    std::vector<unsigned char> & stream = banded ? f.bands : f.singleBand;
+    std::vector<unsigned char> out(ImageCodec::maxEncodedBytes(width, height, channels, banded ? 0 : height));
+    throughput(iterations, f, stream.size(), [&]()
+               { ImageCodec::encode(f.frame, &out[0], out.size(), banded ? 0 : height); });
+  }
+
+
+  void decode(std::size_t iterations, int channels, bool banded)
+  {
+    Fixture & f = fixture(channels);
+    std::vector<unsigned char> & stream = banded ? f.bands : f.singleBand;
+    throughput(iterations, f, stream.size(), [&]() { ImageCodec::decode(&stream[0], stream.size(), f.copy); });
+  }
+
+
+  struct Registration
+  {
+    Registration()
+    {
+      char const * const names[] = { 0, "1080p gray", "1080p gray+alpha", "1080p RGB", "1080p RGBA" };
+      for(int channels = 1; channels <= 4; ++channels)
+      {
+        std::string const prefix = std::string("ImageCodec/") + names[channels] + "/";
+        Bench::registerCase(prefix + "memcpy", [channels](std::size_t n) { copy(n, channels); });
+        Bench::registerCase(prefix + "encode, one band", [channels](std::size_t n) { encode(n, channels, false); });
+        Bench::registerCase(prefix + "encode, bands on the global pool",
+                            [channels](std::size_t n) { encode(n, channels, true); });
+        Bench::registerCase(prefix + "decode, one band", [channels](std::size_t n) { decode(n, channels, false); });
+        Bench::registerCase(prefix + "decode, bands on the global pool",
+                            [channels](std::size_t n) { decode(n, channels, true); });
+      }
+    }
+  } registration;
+
+}  // end of anonymous namespace
@@ -0,0 +1,138 @@
+#include "Benchmark.h"
+
+#include <uenf/Log.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  //! swallows everything, std::cout is redirected to it while the StdCoutLogger cases run
+  class NullBuffer : public std::streambuf
+  {
+  protected:
+    int overflow(int c) { return c; }
+    std::streamsize xsputn(char const *, std::streamsize n) { return n; }
+  };
+
+
+  enum LoggerKind { noLogger, stdCoutLogger, fileLogger };
+
+  char const * const loggerNames[] = { "no logger", "StdCoutLogger", "FileLogger" };
+
+  Log::Severity const severities[] = { Log::debug, Log::info, Log::warning, Log::error, Log::fatal };
+  char const * const severityNames[] = { "debug", "info", "warning", "error", "fatal" };
+
+
+  //! the logger of a case, StdCoutLogger writes into a NullBuffer, FileLogger into /dev/null (still a syscall per line)
+  class LoggerSetup
+  {
+  public:
+    explicit LoggerSetup(LoggerKind kind):coutBuffer(0)
+    {
+      Bench::Pause pause;
+      if(kind == stdCoutLogger)
+      {
+        coutBuffer = std::cout.rdbuf(&nullBuffer);
+        stdCout.reset(new Log::StdCoutLogger("[bench] "));
+      }
+      else if(kind == fileLogger)
+        file.reset(new Log::FileLogger("/dev/null"));
+    }
+
+    ~LoggerSetup()
+    {
+      Bench::Pause pause;
+      stdCout.reset();
+      file.reset();
+      if(coutBuffer)
+        std::cout.rdbuf(coutBuffer);
+    }
+
+  private:
+    NullBuffer nullBuffer;
+    std::streambuf * coutBuffer;
+    boost::scoped_ptr<Log::StdCoutLogger> stdCout;
+    boost::scoped_ptr<Log::FileLogger> file;
+  };
+
+
+  std::string const message("frame 42 decoded in 3.1 ms");
+
+
+  void logLoop(std::size_t iterations, Log::Severity severity)
+  {
+    for(std::size_t i = 0; i < iterations; ++i)
+      Log::log(message, severity);
+  }
+
+
+  void logSeverity(std::size_t iterations, LoggerKind kind, Log::Severity severity)
+  {
+    LoggerSetup setup(kind);
+    logLoop(iterations, severity);
+  }
+
+
+  //! the iterations are split among the threads, so the result is the time per message of all threads together
+  void logThreads(std::size_t iterations, LoggerKind kind, unsigned int threads)
+  {
+    LoggerSetup setup(kind);
+    boost::thread_group group;
+    for(unsigned int t = 0; t < threads; ++t)
+    {
+      std::size_t const share = iterations / threads + (t < iterations % threads ? 1 : 0);
+      group.create_thread([share]() { Bench::unpinCurrentThread(); logLoop(share, Log::info); });
+    }
+    group.join_all();
+  }
+
+
+  struct Registration
+  {
+    Registration()
+    {
+      for(int l = 0; l < 3; ++l)
+      {
+        LoggerKind const kind = LoggerKind(l);
+        for(int s = 0; s < 5; ++s)
+        {
+          Log::Severity const severity = severities[s];
+          Bench::registerCase(std::string("Log/log/") + loggerNames[l] + "/" + severityNames[s],
+                              [kind, severity](std::size_t iterations) { logSeverity(iterations, kind, severity); });
+        }
+      }
+
+      std::vector<unsigned int> threadCounts;
+      unsigned int const hardware = boost::thread::hardware_concurrency();
+      for(unsigned int t = 1; t <= 4; t *= 2)
+        threadCounts.push_back(t);
+      if(hardware > 4)
+        threadCounts.push_back(hardware);
+
+      for(int l = 0; l < 3; ++l)
+      {
+        LoggerKind const kind = LoggerKind(l);
+        for(std::size_t t = 0; t < threadCounts.size(); ++t)
+        {
+          unsigned int const threads = threadCounts[t];
+          std::ostringstream name;
+          name << "Log/log/" << loggerNames[l] << "/info, " << threads << (threads == 1 ? " thread" : " threads");
+          Bench::registerCase(name.str(), [kind, threads](std::size_t iterations)
+                                          { logThreads(iterations, kind, threads); });
+        }
+      }
+    }
+  } registration;
+
+}  // end of anonymous namespace
@@ -0,0 +1,105 @@
+#include "Benchmark.h"
+
+#include <uenf/Metrics.h>
+
+#include <boost/thread/thread.hpp>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  void counterAdd(std::size_t iterations)
+  {
+    Metrics::Counter & counter = Metrics::Registry::global().counter("bench.counter");
+    for(std::size_t i = 0; i < iterations; ++i)
+      ++counter;
+  }
+
+
+  void gaugeAdd(std::size_t iterations)
+  {
+    Metrics::Gauge & gauge = Metrics::Registry::global().gauge("bench.gauge");
+    for(std::size_t i = 0; i < iterations; ++i)
+      ++gauge;
+  }
+
+
+  void histogramRecord(std::size_t iterations)
+  {
+    Metrics::Histogram & histogram = Metrics::Registry::global().histogram("bench.histogram");
+    for(std::size_t i = 0; i < iterations; ++i)
+      histogram.record(i & 0xffff);
+  }
+
+
+  void scopedTimer(std::size_t iterations)
+  {
+    Metrics::Histogram & histogram = Metrics::Registry::global().histogram("bench.timer");
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      Metrics::ScopedTimer timer(histogram);
+      Bench::doNotOptimize(i);
+    }
+  }
+
+
+  void lookupByName(std::size_t iterations)
+  {
+    for(std::size_t i = 0; i < iterations; ++i)
+      Bench::doNotOptimize(Metrics::Registry::global().counter("bench.counter"));
+  }
+
+
+  // four threads hammering the same metric, each doing all iterations, so the result is the time per operation
+  // of one thread under contention; the plain atomic shows what the sharding saves
+  enum { contendingThreads = 4 };
+
+  template<typename Operation> void contended(std::size_t iterations, Operation operation)
+  {
+    boost::thread_group threads;
+    for(int t = 0; t < contendingThreads; ++t)
+      threads.create_thread([iterations, operation]()
+      {
+        Bench::unpinCurrentThread();
+        for(std::size_t i = 0; i < iterations; ++i)
+          operation(i);
+      });
+    threads.join_all();
+  }
+
+
+  void counterContended(std::size_t iterations)
+  {
+    Metrics::Counter * counter = &Metrics::Registry::global().counter("bench.counter");
+    contended(iterations, [counter](std::size_t) { ++*counter; });
+  }
+
+
+  void histogramContended(std::size_t iterations)
+  {
+    Metrics::Histogram * histogram = &Metrics::Registry::global().histogram("bench.histogram");
+    contended(iterations, [histogram](std::size_t i) { histogram->record(i & 0xffff); });
+  }
+
+
+  boost::atomic<boost::uint64_t> plainAtomic(0);
+
+  void plainAtomicContended(std::size_t iterations)
+  {
+    contended(iterations, [](std::size_t) { plainAtomic.fetch_add(1, boost::memory_order_relaxed); });
+  }
+
+
+  Bench::Registrar r1("Metrics/counter/add",                   &counterAdd);
+  Bench::Registrar r2("Metrics/gauge/add",                     &gaugeAdd);
+  Bench::Registrar r3("Metrics/histogram/record",              &histogramRecord);
+  Bench::Registrar r4("Metrics/histogram/ScopedTimer",         &scopedTimer);
+  Bench::Registrar r5("Metrics/registry/lookup by name",       &lookupByName);
+  Bench::Registrar r6("Metrics/counter/add (4 threads)",       &counterContended);
+  Bench::Registrar r7("Metrics/histogram/record (4 threads)",  &histogramContended);
+  Bench::Registrar r8("Metrics/plain atomic/add (4 threads)",  &plainAtomicContended);
+
+}  // end of anonymous namespace
@@ -0,0 +1,80 @@
+
+
+
+#include "Benchmark.h"
+
+#include <uenf/Signal.h>
+
+#include <boost/bind/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <map>
+#include <vector>
+#include <ciso646>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  struct Receiver
+  {
+    Receiver():sum(0) {}
+    void onValue(int value) { sum += value; }
+    int sum;
+  };
+
+
+  //! a signal with slotCount direct slots connected (each a bound member function)
+  struct Fixture
+  {
+    explicit Fixture(std::size_t slotCount):receivers(slotCount)
+    {
+      for(std::size_t i = 0; i < slotCount; ++i)
+        signal.connect(boost::bind(&Receiver::onValue, &receivers[i], boost::placeholders::_1));
+    }
+
+    Signal<void (int)> signal;
+    std::vector<Receiver> receivers;
+  };
+
+  // built once and kept, so connecting (a snapshot copy per slot) is not part of the measured emits
+  Fixture & fixture(std::size_t slotCount)
+  {
+    static std::map<std::size_t, Fixture *> fixtures;
+    Fixture * & f = fixtures[slotCount];
+    if(not f)
+    {
+      Bench::Pause pause;
+      f = new Fixture(slotCount);
+    }
+    return *f;
+  }
+
+
+  // cost of one emit with slotCount direct slots connected
+  void emitDirect(std::size_t slotCount, std::size_t iterations)
+  {
+    Fixture & f = fixture(slotCount);
+    for(std::size_t i = 0; i < iterations; ++i)
+      f.signal(int(i));
+
+    for(std::size_t i = 0; i < slotCount; ++i)
+      Bench::doNotOptimize(f.receivers[i].sum);
+  }
+
+
+  struct Registration
+  {
+    Registration()
+    {
+      std::size_t const counts[] = { 0, 1, 8, 64 };
+      for(std::size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+        Bench::registerCase("Signal/emit/" + boost::lexical_cast<std::string>(counts[i]) + " slots",
+                            boost::bind(&emitDirect, counts[i], boost::placeholders::_1));
+    }
+  } registration;
+
+}  // end of anonymous namespace
@@ -0,0 +1,95 @@
+#include "Benchmark.h"
+
+#include <uenf/ThreadedObject.h>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  class Idle : public ThreadedObject
+  {
+  public:
+    ~Idle() { stopAndWaitForThreadToExit(); }
+  protected:
+    void run()
+    {
+      while(not stop)
+        boost::this_thread::yield();
+    }
+  };
+
+
+  class Immediate : public ThreadedObject
+  {
+  public:
+    ~Immediate() { stopAndWaitForThreadToExit(); }
+  protected:
+    void run() {}
+  };
+
+
+  // startThread() returns when the new thread runs, so this is creation plus the handshake
+  void start(std::size_t iterations)
+  {
+    Idle object;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      object.startThread();
+      Bench::Pause pause;
+      object.stopAndWaitForThreadToExit();
+    }
+  }
+
+
+  // from setting the stop flag until the thread (polling it) has been joined
+  void stopJoin(std::size_t iterations)
+  {
+    Idle object;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      {
+        Bench::Pause pause;
+        object.startThread();
+      }
+      object.stopAndWaitForThreadToExit();
+    }
+  }
+
+
+  // joining a thread whose run() already returned
+  void joinFinished(std::size_t iterations)
+  {
+    Immediate object;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      {
+        Bench::Pause pause;
+        object.startThread();
+        while(object.isRunning())
+          boost::this_thread::yield();
+      }
+      object.joinThread();
+    }
+  }
+
+
+  void cycle(std::size_t iterations)
+  {
+    Immediate object;
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      object.startThread();
+      object.stopAndWaitForThreadToExit();
+    }
+  }
+
+
+  Bench::Registrar r1("ThreadedObject/startThread",              &start);
+  Bench::Registrar r2("ThreadedObject/stop+join (polling run)",  &stopJoin);
+  Bench::Registrar r3("ThreadedObject/join (run finished)",      &joinFinished);
+  Bench::Registrar r4("ThreadedObject/start+stop+join",          &cycle);
+
+}  // end of anonymous namespace
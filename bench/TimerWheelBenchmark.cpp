@@ -0,0 +1,192 @@
+#include "Benchmark.h"
+
+#include <uenf/TimerWheel.h>
+#include <uenf/Metrics.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+  typedef TimerWheel::Clock Clock;
+
+
+  void nothing() {}
+
+
+  // the wheel thread is not started, so these are the pure costs of the data structure (plus its mutex)
+  void scheduleCancel(std::size_t iterations)
+  {
+    TimerWheel wheel;
+    for(std::size_t i = 0; i < iterations; ++i)
+      wheel.cancel(wheel.scheduleOnce(std::chrono::milliseconds(10 + i % 100000), &nothing));
+  }
+
+
+  TimerWheel & millionPending()
+  {
+    static boost::scoped_ptr<TimerWheel> wheel;
+    if(not wheel)
+    {
+      wheel.reset(new TimerWheel);
+      for(std::size_t i = 0; i < 1000000; ++i) // spread over an hour, so all levels are in use
+        wheel->scheduleOnce(std::chrono::milliseconds((i * 7919) % 3600000 + 1), &nothing);
+    }
+    return *wheel;
+  }
+
+  void scheduleCancelMillionPending(std::size_t iterations)
+  {
+    TimerWheel & wheel = millionPending();
+    for(std::size_t i = 0; i < iterations; ++i)
+      wheel.cancel(wheel.scheduleOnce(std::chrono::milliseconds(10 + (i * 7919) % 3600000), &nothing));
+  }
+
+
+  void scheduleThenCancelAll(std::size_t iterations)
+  {
+    TimerWheel & wheel = millionPending();
+    std::vector<TimerWheel::TimerId> ids(iterations);
+    for(std::size_t i = 0; i < iterations; ++i)
+      ids[i] = wheel.scheduleOnce(std::chrono::milliseconds(10 + (i * 7919) % 3600000), &nothing);
+    for(std::size_t i = 0; i < iterations; ++i)
+      wheel.cancel(ids[i]);
+  }
+
+
+  struct Completion
+  {
+    Completion(std::size_t expectedArg):expected(expectedArg), count(0) {}
+    void wait()
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while(count < expected)
+        done.wait(lock);
+    }
+    void increment()
+    {
+      boost::lock_guard<boost::mutex> guard(mutex);
+      if(++count == expected)
+        done.notify_all();
+    }
+    std::size_t const expected;
+    std::size_t count;
+    boost::mutex mutex;
+    boost::condition_variable done;
+  };
+
+
+  // one-shot timers with deadlines spread over 10 ms, time per timer from scheduling until all fired
+  void expire(std::size_t iterations)
+  {
+    TimerWheel wheel;
+    wheel.startThread();
+    Completion completion(iterations);
+    Completion * c = &completion;
+    for(std::size_t i = 0; i < iterations; ++i)
+      wheel.scheduleOnce(std::chrono::microseconds(i % 10000), [c]() { c->increment(); });
+    completion.wait();
+  }
+
+
+  void noteLateness(Metrics::Histogram const & lateness)
+  {
+    Metrics::Histogram::Snapshot const s = lateness.snapshot();
+    std::ostringstream oss;
+    oss << "lateness p50 " << s.quantile(0.5) / 1000 << " us, p99 " << s.quantile(0.99) / 1000 << " us, max "
+        << s.max() / 1000 << " us (" << s.count << " firings)";
+    Bench::note(oss.str());
+  }
+
+
+  // a 1 ms fixed-rate timer on a wheel with 100 us ticks, lateness is the time of the call after its deadline
+  void periodicLateness(std::size_t iterations)
+  {
+    boost::scoped_ptr<Metrics::Histogram> lateness(new Metrics::Histogram);
+    Completion completion(iterations);
+
+    TimerWheel wheel(std::chrono::microseconds(100));
+    wheel.startThread();
+
+    Clock::duration const period = std::chrono::milliseconds(1);
+    Clock::time_point const start = Clock::now();
+    std::size_t firings = 0;
+    Metrics::Histogram * l = lateness.get();
+    Completion * c = &completion;
+    TimerWheel::TimerId const id = wheel.schedulePeriodic(period, [=, &firings]()
+    {
+      if(firings < c->expected)
+      {
+        Clock::time_point const deadline = start + period * (++firings);
+        l->record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - deadline).count());
+        c->increment();
+      }
+    });
+    completion.wait();
+    wheel.cancel(id);
+    noteLateness(*lateness);
+  }
+
+
+  /* rounds of 1000 one-shot timers with deadlines spread over 5 ms on 1 ms ticks, without and with coalescing
+     into 5 ms windows, the wakeups are counted as groups of calls less than 100 us apart (all calls run on the
+     timer thread, one after another)
+  */
+  void oneShotLateness(std::size_t iterations, Clock::duration coalescing)
+  {
+    enum { timersPerRound = 1000 };
+    boost::scoped_ptr<Metrics::Histogram> lateness(new Metrics::Histogram);
+    TimerWheel wheel(std::chrono::milliseconds(1), coalescing);
+    wheel.startThread();
+
+    std::size_t const rounds = (iterations + timersPerRound - 1) / timersPerRound;
+    std::size_t wakeups = 0;
+    Clock::time_point lastCall;
+    for(std::size_t round = 0; round < rounds; ++round)
+    {
+      Completion completion(timersPerRound);
+      Metrics::Histogram * l = lateness.get();
+      Completion * c = &completion;
+      std::size_t * w = &wakeups;
+      Clock::time_point * last = &lastCall;
+      Clock::time_point const start = Clock::now();
+      for(int i = 0; i < timersPerRound; ++i)
+      {
+        Clock::time_point const deadline = start + std::chrono::microseconds(5 * i);
+        wheel.scheduleAt(deadline, [=]()
+        {
+          Clock::time_point const now = Clock::now();
+          if(now - *last > std::chrono::microseconds(100))
+            ++*w;
+          *last = now;
+          l->record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count());
+          c->increment();
+        });
+      }
+      completion.wait();
+    }
+    noteLateness(*lateness);
+    std::ostringstream oss;
+    oss << double(wakeups) / double(rounds) << " wakeups per round";
+    Bench::note(oss.str());
+  }
+
+  void oneShotUncoalesced(std::size_t iterations) { oneShotLateness(iterations, Clock::duration::zero()); }
+  void oneShotCoalesced(std::size_t iterations)   { oneShotLateness(iterations, std::chrono::milliseconds(5)); }
+
+
+  Bench::Registrar r1("TimerWheel/schedule+cancel",                          &scheduleCancel);
+  Bench::Registrar r2("TimerWheel/schedule+cancel (1M pending)",             &scheduleCancelMillionPending);
+  Bench::Registrar r3("TimerWheel/schedule all, cancel all (1M pending)",    &scheduleThenCancelAll);
+  Bench::Registrar r4("TimerWheel/expire one-shot on timer thread",          &expire);
+  Bench::Registrar r5("TimerWheel/periodic 1 ms, 100 us ticks",              &periodicLateness);
+  Bench::Registrar r6("TimerWheel/1000 one-shot over 5 ms",                  &oneShotUncoalesced);
+  Bench::Registrar r7("TimerWheel/1000 one-shot over 5 ms, coalesced",       &oneShotCoalesced);
+
+}  // end of anonymous namespace
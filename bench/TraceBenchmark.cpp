@@ -0,0 +1,73 @@
+
+
+#include "Benchmark.h"
+
+#include <uenf/Trace.h>
+
+
+namespace
+{
+
+  using namespace uenf;
+
+
+  void zoneDisabled(std::size_t iterations)
+  {
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      UENF_TRACE_ZONE("bench::zone");
+      Bench::doNotOptimize(i);
+    }
+  }
+
+
+  // the rings are flushed to /dev/null in the binary format, so the numbers are the pure recording cost
+  // (a zone records two events, begin and end)
+  void zoneEnabled(std::size_t iterations)
+  {
+    {
+      Bench::Pause pause; // starting calibrates the TSC for 10 ms
+      Trace::start("/dev/null", Trace::binary, 1, 1 << 20);
+    }
+    for(std::size_t i = 0; i < iterations; ++i)
+    {
+      UENF_TRACE_ZONE("bench::zone");
+      Bench::doNotOptimize(i);
+    }
+    Bench::Pause pause;
+    Trace::stop();
+  }
+
+
+  void instantEnabled(std::size_t iterations)
+  {
+    {
+      Bench::Pause pause; // starting calibrates the TSC for 10 ms
+      Trace::start("/dev/null", Trace::binary, 1, 1 << 20);
+    }
+    for(std::size_t i = 0; i < iterations; ++i)
+      UENF_TRACE_INSTANT("bench::instant");
+    Bench::Pause pause;
+    Trace::stop();
+  }
+
+
+  void counterEnabled(std::size_t iterations)
+  {
+    {
+      Bench::Pause pause; // starting calibrates the TSC for 10 ms
+      Trace::start("/dev/null", Trace::binary, 1, 1 << 20);
+    }
+    for(std::size_t i = 0; i < iterations; ++i)
+      UENF_TRACE_COUNTER("bench::counter", i);
+    Bench::Pause pause;
+    Trace::stop();
+  }
+
+
+  Bench::Registrar r1("Trace/zone/disabled",   &zoneDisabled);
+  Bench::Registrar r2("Trace/zone/enabled",    &zoneEnabled);
+  Bench::Registrar r3("Trace/instant/enabled", &instantEnabled);
+  Bench::Registrar r4("Trace/counter/enabled", &counterEnabled);
+
+}  // end of anonymous namespace
@@ -0,0 +1,897 @@
+#include <uenf/AsyncIO.h>
+#include <uenf/ThreadedObject.h>
+#include <uenf/ThreadPool.h>
+#include <uenf/Log.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/exception/diagnostic_information.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+  #if __has_include(<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #define UENF_ASYNCIO_HAS_IO_URING
+  #endif
+#endif
+
+#include <algorithm>
+#include <deque>
+#include <system_error>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+
+
+namespace
+{
+
+  struct Request
+  {
+    enum Operation { read, write, sync };
+
+    Operation operation;
+    int fd;
+    int fixedSlot;
+    void * buffer;
+    std::size_t bytes;
+    boost::uint64_t offset;
+    IOEngine::Callback callback;
+    std::string const * fileName;
+  };
+
+  std::size_t const maxRequestBytes = 0x7ffff000; // like Linux, which never transfers more in one call
+
+}
+
+
+
+/*!
+  Common part of both backends: limits the requests in flight to the queue depth and delivers completions.
+  The thread(s) delivering completions never block on the limit, as callbacks (and resumed coroutines) typically
+  issue the next request, and nobody else would deliver the completions freeing the slots. Their requests beyond
+  the limit go to a backlog instead, which is submitted (before any blocked thread gets a slot) as completions free
+  slots; so the requests in flight never exceed the queue depth (and the completion queue of the ring, twice
+  as large, never overflows). Requests deferred by a
+  Batch count as in flight, so a thread about to block on the limit flushes them first, and while threads are
+  blocked, backends submit right away even within a Batch.
+*/
+class IOEngine::Implementation : boost::noncopyable
+{
+public:
+  explicit Implementation(unsigned int queueDepthArg):queueDepth(queueDepthArg), inFlight(0), batches(0),
+    blocked(0) {}
+  virtual ~Implementation() {}
+
+  virtual Backend backend() const = 0;
+
+  virtual void registerBuffers(void * const *, std::size_t const *, std::size_t) {}
+  virtual void unregisterBuffers() {}
+  //! returns the slot in the fixed file table, -1 if there is none
+  virtual int registerFile(int) { return -1; }
+  virtual void unregisterFile(int) {}
+
+  void issue(Request::Operation operation, AsyncFile const & file, int fd, int fixedSlot, void * buffer,
+             std::size_t bytes, boost::uint64_t offset, Callback && callback)
+  {
+    if(callback.empty())
+      BOOST_THROW_EXCEPTION(ExceptionParameter(4));
+
+    bool const admitted = acquire();
+    Request * request = 0;
+    try
+    {
+      request = new Request;
+      request->operation = operation;
+      request->fd = fd;
+      request->fixedSlot = fixedSlot;
+      request->buffer = buffer;
+      request->bytes = std::min(bytes, maxRequestBytes);
+      request->offset = offset;
+      request->callback = std::move(callback);
+      request->fileName = &file.name();
+      if(admitted)
+        submit(request);
+      else
+      {
+        boost::lock_guard<boost::mutex> guard(flightMutex);
+        backlog.push_back(request);
+      }
+    }
+    catch(...) // submit() throws only if it did not queue the request
+    {
+      delete request;
+      if(admitted)
+        release();
+      throw;
+    }
+    if(not admitted) // slots may have been freed meanwhile by another thread delivering completions
+      submitBacklog();
+  }
+
+  //! result is the number of bytes or a negative errno, to be called by the thread(s) delivering completions
+  void complete(Request * request, int result)
+  {
+    Expected<std::size_t> r(std::size_t(0));
+    if(result < 0)
+      r = Error::makeIO(specOf(request->operation), *request->fileName + ": " +
+                        std::generic_category().message(-result));
+    else
+      r = std::size_t(result);
+
+    release(); // before the callback, which might issue the next request
+    submitBacklog();
+    deliver(request, r);
+  }
+
+  void drain()
+  {
+    boost::unique_lock<boost::mutex> lock(flightMutex);
+    while(inFlight or not backlog.empty())
+      flightChanged.wait(lock);
+  }
+
+  bool idle()
+  {
+    boost::lock_guard<boost::mutex> guard(flightMutex);
+    return not inFlight and backlog.empty();
+  }
+
+  void beginBatch() { batches.fetch_add(1); }
+  void endBatch()
+  {
+    if(batches.fetch_sub(1) == 1)
+      flush();
+  }
+
+protected:
+  //! takes ownership of the request, unless it throws
+  virtual void submit(Request * request) = 0;
+  //! submits the requests deferred by batches
+  virtual void flush() {}
+
+  bool inBatch() const { return batches.load() > 0; }
+  //! a thread waits for a free slot, deferring requests could leave it waiting forever
+  bool slotsAwaited() const { return blocked.load() > 0; }
+
+  static ExceptionIO::Spec specOf(Request::Operation operation)
+  {
+    switch(operation)
+    {
+      case Request::read:  return ExceptionIO::read;
+      case Request::write: return ExceptionIO::write;
+      default:             return ExceptionIO::access;
+    }
+  }
+
+  //! set on the thread(s) delivering completions of this engine
+  static thread_local Implementation * completingEngine;
+
+private:
+  //! false for a thread delivering completions at the limit, the request goes to the backlog then
+  bool acquire()
+  {
+    boost::unique_lock<boost::mutex> lock(flightMutex);
+    if(completingEngine == this)
+    {
+      if(inFlight >= queueDepth or not backlog.empty())
+        return false;
+    }
+    else if(inFlight >= queueDepth or not backlog.empty())
+    {
+      // Requests deferred by a Batch would never complete and free a slot. Those issued from now on see
+      // slotsAwaited() and are submitted right away, flush() takes care of the ones issued before.
+      blocked.fetch_add(1);
+      try
+      {
+        lock.unlock();
+        flush();
+        lock.lock();
+        while(inFlight >= queueDepth or not backlog.empty())
+          flightChanged.wait(lock);
+      }
+      catch(...)
+      {
+        blocked.fetch_sub(1);
+        throw;
+      }
+      blocked.fetch_sub(1);
+    }
+    ++inFlight;
+    return true;
+  }
+
+  void release()
+  {
+    boost::lock_guard<boost::mutex> guard(flightMutex);
+    --inFlight;
+    flightChanged.notify_all();
+  }
+
+  //! submits backlogged requests as long as there are free slots, a failing submission fails the request
+  void submitBacklog()
+  {
+    while(true)
+    {
+      Request * request;
+      {
+        boost::lock_guard<boost::mutex> guard(flightMutex);
+        if(backlog.empty() or inFlight >= queueDepth)
+          return;
+        request = backlog.front();
+        backlog.pop_front();
+        ++inFlight;
+        if(backlog.empty())
+          flightChanged.notify_all(); // blocked threads and drain() wait for it
+      }
+      try
+      {
+        submit(request);
+      }
+      catch(...)
+      {
+        Expected<std::size_t> const r(Error::fromCurrentException());
+        release();
+        deliver(request, r);
+      }
+    }
+  }
+
+  void deliver(Request * request, Expected<std::size_t> const & r)
+  {
+    boost::scoped_ptr<Request> owner(request);
+    try
+    {
+      request->callback(r);
+    }
+    catch(...)
+    {
+      Log::log("IOEngine: completion callback threw:\n" + boost::current_exception_diagnostic_information(),
+               Log::error);
+    }
+  }
+
+  unsigned int const queueDepth;
+  unsigned int inFlight;
+  boost::mutex flightMutex;
+  boost::condition_variable flightChanged;
+  boost::atomic<int> batches;
+  boost::atomic<int> blocked; // threads in acquire() waiting for a slot
+  std::deque<Request *> backlog; // requests of completion threads beyond the limit, needs the flightMutex
+};
+
+
+
+thread_local IOEngine::Implementation * IOEngine::Implementation::completingEngine = 0;
+
+
+
+
+namespace
+{
+
+  int blockingTransfer(Request const & request)
+  {
+    ssize_t result = 0;
+    do
+    {
+      switch(request.operation)
+      {
+        case Request::read:  result = ::pread(request.fd, request.buffer, request.bytes, off_t(request.offset)); break;
+        case Request::write: result = ::pwrite(request.fd, request.buffer, request.bytes, off_t(request.offset)); break;
+        case Request::sync:  result = ::fsync(request.fd); break;
+      }
+    }
+    while(result < 0 and errno == EINTR);
+    return result < 0 ? -errno : int(result);
+  }
+
+
+
+  //! the fallback: blocking calls on a pool of threads
+  class ThreadPoolEngine : public IOEngine::Implementation
+  {
+  public:
+    ThreadPoolEngine(unsigned int queueDepth, unsigned int threads):Implementation(queueDepth), pool(threads) {}
+    ~ThreadPoolEngine() { drain(); }
+
+    IOEngine::Backend backend() const { return IOEngine::threadPool; }
+
+  protected:
+    void submit(Request * request)
+    {
+      pool.post([this, request]() { process(request); });
+    }
+
+  private:
+    void process(Request * request)
+    {
+      completingEngine = this;
+      complete(request, blockingTransfer(*request));
+    }
+
+    ThreadPool pool;
+  };
+
+
+
+
+#ifdef UENF_ASYNCIO_HAS_IO_URING
+
+  int ioUringSetup(unsigned int entries, io_uring_params * params)
+  {
+    return int(::syscall(__NR_io_uring_setup, entries, params));
+  }
+
+  int ioUringEnter(int ringFd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+  {
+    return int(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, 0, 0));
+  }
+
+  int ioUringRegister(int ringFd, unsigned int opcode, void const * arg, unsigned int count)
+  {
+    return int(::syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+  }
+
+  template<typename T> T loadAcquire(T const * p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+  template<typename T> void storeRelease(T * p, T value) { __atomic_store_n(p, value, __ATOMIC_RELEASE); }
+
+  std::string systemErrorText() { return std::generic_category().message(errno); }
+
+
+
+  /*!
+    io_uring driven by plain system calls (no liburing): submitters fill the submission ring under a mutex, a
+    completion thread waits in io_uring_enter() and runs the callbacks. A NOP without request wakes it for stopping.
+  */
+  class UringEngine : public IOEngine::Implementation
+  {
+  public:
+    enum { fixedFiles = 256 };
+
+    explicit UringEngine(unsigned int queueDepth):Implementation(queueDepth), ringFd(-1), sqRing(MAP_FAILED),
+      cqRing(MAP_FAILED), sqes(static_cast<io_uring_sqe *>(MAP_FAILED)), sqRingBytes(0), cqRingBytes(0),
+      sqesBytes(0), sqTailLocal(0), unsubmitted(0), fixedFilesEnabled(false), completion(*this)
+    {
+      io_uring_params params;
+      std::memset(&params, 0, sizeof(params));
+      params.flags = IORING_SETUP_CQSIZE;
+      params.cq_entries = 2 * queueDepth; // never more than the depth in flight, headroom for the wakeup NOP
+      ringFd = ioUringSetup(queueDepth, &params);
+      if(ringFd < 0)
+        BOOST_THROW_EXCEPTION(ExceptionRuntime("io_uring_setup failed: " + systemErrorText()));
+
+      try
+      {
+        mapRings(params);
+      }
+      catch(...)
+      {
+        unmapRings();
+        throw;
+      }
+
+      std::vector<int> sparse(fixedFiles, -1);
+      fixedFilesEnabled = ioUringRegister(ringFd, IORING_REGISTER_FILES, &sparse[0], fixedFiles) == 0;
+      fixedSlotUsed.assign(fixedFilesEnabled ? fixedFiles : 0, false);
+
+      completion.startThread();
+    }
+
+    ~UringEngine()
+    {
+      drain();
+      completion.stopAndWaitForThreadToExit();
+      unmapRings();
+    }
+
+    IOEngine::Backend backend() const { return IOEngine::ioUring; }
+
+    void registerBuffers(void * const * buffers, std::size_t const * sizes, std::size_t count)
+    {
+      if(not idle())
+        BOOST_THROW_EXCEPTION(ExceptionCode("IOEngine::registerBuffers() with requests in flight"));
+      boost::lock_guard<boost::mutex> guard(submitMutex);
+      unregisterBuffersLocked();
+      std::vector<iovec> iovecs(count);
+      for(std::size_t i = 0; i < count; ++i)
+      {
+        iovecs[i].iov_base = buffers[i];
+        iovecs[i].iov_len = sizes[i];
+      }
+      if(count and ioUringRegister(ringFd, IORING_REGISTER_BUFFERS, &iovecs[0], unsigned(count)) < 0)
+        BOOST_THROW_EXCEPTION(ExceptionRuntime("registering buffers failed: " + systemErrorText()));
+      registered.swap(iovecs);
+    }
+
+    void unregisterBuffers()
+    {
+      if(not idle())
+        BOOST_THROW_EXCEPTION(ExceptionCode("IOEngine::unregisterBuffers() with requests in flight"));
+      boost::lock_guard<boost::mutex> guard(submitMutex);
+      unregisterBuffersLocked();
+    }
+
+    int registerFile(int fd)
+    {
+      boost::lock_guard<boost::mutex> guard(submitMutex);
+      std::vector<bool>::iterator it = std::find(fixedSlotUsed.begin(), fixedSlotUsed.end(), false);
+      if(it == fixedSlotUsed.end())
+        return -1;
+      int const slot = int(it - fixedSlotUsed.begin());
+      if(not updateFixedFile(slot, fd))
+        return -1;
+      *it = true;
+      return slot;
+    }
+
+    void unregisterFile(int slot)
+    {
+      boost::lock_guard<boost::mutex> guard(submitMutex);
+      updateFixedFile(slot, -1);
+      fixedSlotUsed[slot] = false;
+    }
+
+  protected:
+    void submit(Request * request)
+    {
+      boost::lock_guard<boost::mutex> guard(submitMutex);
+      io_uring_sqe * sqe = nextSqe();
+      sqe->user_data = reinterpret_cast<boost::uint64_t>(request);
+      sqe->off = request->offset;
+      sqe->fd = request->fixedSlot >= 0 ? request->fixedSlot : request->fd;
+      if(request->fixedSlot >= 0)
+        sqe->flags |= IOSQE_FIXED_FILE;
+
+      if(request->operation == Request::sync)
+        sqe->opcode = IORING_OP_FSYNC;
+      else
+      {
+        bool const reading = request->operation == Request::read;
+        sqe->addr = reinterpret_cast<boost::uint64_t>(request->buffer);
+        sqe->len = unsigned(request->bytes);
+        int const buffer = registeredBufferOf(request->buffer, request->bytes);
+        if(buffer >= 0)
+        {
+          sqe->opcode = reading ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+          sqe->buf_index = (unsigned short)buffer;
+        }
+        else
+          sqe->opcode = reading ? IORING_OP_READ : IORING_OP_WRITE;
+      }
+      commitSqe();
+
+      if(not inBatch() or slotsAwaited())
+        try
+        {
+          enter();
+        }
+        catch(...) // not submitted, so the caller still owns the request
+        {
+          rollbackSqe();
+          throw;
+        }
+    }
+
+    void flush()
+    {
+      boost::lock_guard<boost::mutex> guard(submitMutex);
+      enter();
+    }
+
+  private:
+    class CompletionThread : public ThreadedObject
+    {
+    public:
+      explicit CompletionThread(UringEngine & engineArg):engine(engineArg) {}
+      ~CompletionThread() { stopAndWaitForThreadToExit(); }
+
+      void stopThread()
+      {
+        ThreadedObject::stopThread();
+        if(isRunning())
+          engine.wakeCompletionThread();
+      }
+
+    protected:
+      void run() { engine.reap(stop); }
+
+    private:
+      UringEngine & engine;
+    };
+
+
+    void mapRings(io_uring_params const & params)
+    {
+      sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+      cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      bool const single = params.features & IORING_FEAT_SINGLE_MMAP;
+      if(single)
+        sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+
+      sqRing = ::mmap(0, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+      if(sqRing == MAP_FAILED)
+        BOOST_THROW_EXCEPTION(ExceptionRuntime("mapping the io_uring failed: " + systemErrorText()));
+      cqRing = single ? sqRing :
+               ::mmap(0, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+      if(cqRing == MAP_FAILED)
+        BOOST_THROW_EXCEPTION(ExceptionRuntime("mapping the io_uring failed: " + systemErrorText()));
+      sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+      sqes = static_cast<io_uring_sqe *>(::mmap(0, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                 ringFd, IORING_OFF_SQES));
+      if(sqes == MAP_FAILED)
+        BOOST_THROW_EXCEPTION(ExceptionRuntime("mapping the io_uring failed: " + systemErrorText()));
+
+      char * sq = static_cast<char *>(sqRing);
+      sqHead  = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+      sqTail  = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+      sqMask  = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+      sqSize  = params.sq_entries;
+      sqArray = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+      sqTailLocal = *sqTail;
+
+      char * cq = static_cast<char *>(cqRing);
+      cqHead = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+      cqTail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+      cqMask = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+      cqes   = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    void unmapRings()
+    {
+      if(sqes not_eq MAP_FAILED)
+        ::munmap(sqes, sqesBytes);
+      if(cqRing not_eq MAP_FAILED and cqRing not_eq sqRing)
+        ::munmap(cqRing, cqRingBytes);
+      if(sqRing not_eq MAP_FAILED)
+        ::munmap(sqRing, sqRingBytes);
+      if(ringFd >= 0)
+        ::close(ringFd);
+    }
+
+    // the following need the submitMutex
+
+    io_uring_sqe * nextSqe()
+    {
+      while(sqTailLocal - loadAcquire(sqHead) >= sqSize) // full, even within a batch
+        enter();
+      io_uring_sqe * sqe = &sqes[sqTailLocal & sqMask];
+      std::memset(sqe, 0, sizeof(io_uring_sqe));
+      return sqe;
+    }
+
+    void commitSqe()
+    {
+      sqArray[sqTailLocal & sqMask] = sqTailLocal & sqMask;
+      ++sqTailLocal;
+      storeRelease(sqTail, sqTailLocal);
+      ++unsubmitted;
+    }
+
+    /*! takes back the last committed entry, if enter() failed on it: it is the newest of the unsubmitted ones, and
+        without SQPOLL the kernel reads the ring only within io_uring_enter()
+    */
+    void rollbackSqe()
+    {
+      --sqTailLocal;
+      storeRelease(sqTail, sqTailLocal);
+      --unsubmitted;
+    }
+
+    void enter()
+    {
+      while(unsubmitted)
+      {
+        int const submitted = ioUringEnter(ringFd, unsubmitted, 0, 0);
+        if(submitted < 0)
+        {
+          if(errno == EINTR or errno == EAGAIN or errno == EBUSY) // busy: completions not reaped yet
+          {
+            boost::this_thread::yield();
+            continue;
+          }
+          BOOST_THROW_EXCEPTION(ExceptionRuntime("io_uring_enter failed: " + systemErrorText()));
+        }
+        unsubmitted -= unsigned(submitted);
+      }
+    }
+
+    int registeredBufferOf(void const * buffer, std::size_t bytes) const
+    {
+      char const * begin = static_cast<char const *>(buffer);
+      for(std::size_t i = 0; i < registered.size(); ++i)
+      {
+        char const * base = static_cast<char const *>(registered[i].iov_base);
+        if(begin >= base and begin + bytes <= base + registered[i].iov_len)
+          return int(i);
+      }
+      return -1;
+    }
+
+    void unregisterBuffersLocked()
+    {
+      if(not registered.empty())
+        ioUringRegister(ringFd, IORING_UNREGISTER_BUFFERS, 0, 0);
+      registered.clear();
+    }
+
+    bool updateFixedFile(int slot, int fd)
+    {
+      io_uring_files_update update;
+      std::memset(&update, 0, sizeof(update));
+      update.offset = unsigned(slot);
+      update.fds = reinterpret_cast<boost::uint64_t>(&fd);
+      return ioUringRegister(ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+    }
+
+    void wakeCompletionThread()
+    {
+      boost::lock_guard<boost::mutex> guard(submitMutex);
+      io_uring_sqe * sqe = nextSqe();
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = 0;
+      commitSqe();
+      enter();
+    }
+
+    // the completion thread
+
+    /*! A failing io_uring_enter() does not end the thread, the requests in flight would never complete (and
+        drain() would wait forever). It is logged once and retried after a short pause until it succeeds again.
+    */
+    void reap(volatile bool const & stop)
+    {
+      completingEngine = this;
+      bool failing = false;
+      while(true)
+      {
+        unsigned int head = *cqHead;
+        unsigned int const tail = loadAcquire(cqTail);
+        for(; head not_eq tail; ++head)
+        {
+          io_uring_cqe const & cqe = cqes[head & cqMask];
+          Request * request = reinterpret_cast<Request *>(cqe.user_data);
+          int const result = cqe.res;
+          storeRelease(cqHead, head + 1); // free the entry before the callback runs (and maybe submits)
+          if(request)
+            complete(request, result);
+        }
+        if(stop)
+          break;
+        if(ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) >= 0 or errno == EINTR or errno == EAGAIN)
+          failing = false;
+        else
+        {
+          if(not failing)
+            Log::log("IOEngine: waiting for completions failed, retrying: io_uring_enter: " + systemErrorText(),
+                     Log::error);
+          failing = true;
+          ::usleep(1000);
+        }
+      }
+    }
+
+
+    int ringFd;
+    void * sqRing;
+    void * cqRing;
+    io_uring_sqe * sqes;
+    std::size_t sqRingBytes, cqRingBytes, sqesBytes;
+
+    unsigned int * sqHead;
+    unsigned int * sqTail;
+    unsigned int * sqArray;
+    unsigned int sqMask, sqSize;
+    unsigned int sqTailLocal;
+    unsigned int unsubmitted;
+
+    unsigned int * cqHead;
+    unsigned int * cqTail;
+    unsigned int cqMask;
+    io_uring_cqe * cqes;
+
+    boost::mutex submitMutex;
+    std::vector<iovec> registered;
+    bool fixedFilesEnabled;
+    std::vector<bool> fixedSlotUsed;
+
+    CompletionThread completion; // last, so it is started after and stopped before everything else
+  };
+
+#endif // UENF_ASYNCIO_HAS_IO_URING
+
+}  // end of anonymous namespace
+
+
+
+
+
+
+IOEngine::IOEngine(unsigned int queueDepth, Backend backend, unsigned int fallbackThreads)
+{
+  queueDepth = std::max(1u, std::min(queueDepth, 4096u));
+#ifdef UENF_ASYNCIO_HAS_IO_URING
+  if(backend not_eq threadPool)
+  {
+    try
+    {
+      impl.reset(new UringEngine(queueDepth));
+    }
+    catch(ExceptionRuntime const &)
+    {
+      if(backend == ioUring)
+        throw;
+    }
+  }
+#else
+  if(backend == ioUring)
+    BOOST_THROW_EXCEPTION(ExceptionRuntime("io_uring is not available on this system"));
+#endif
+  if(not impl)
+    impl.reset(new ThreadPoolEngine(queueDepth, std::max(1u, fallbackThreads)));
+}
+
+
+
+IOEngine::~IOEngine()
+{
+}
+
+
+
+IOEngine::Backend IOEngine::backend() const
+{
+  return impl->backend();
+}
+
+
+
+void IOEngine::registerBuffers(void * const * buffers, std::size_t const * sizes, std::size_t count)
+{
+  impl->registerBuffers(buffers, sizes, count);
+}
+
+
+
+void IOEngine::unregisterBuffers()
+{
+  impl->unregisterBuffers();
+}
+
+
+
+void IOEngine::drain()
+{
+  impl->drain();
+}
+
+
+
+IOEngine::Batch::Batch(IOEngine & engineArg):engine(engineArg)
+{
+  engine.impl->beginBatch();
+}
+
+
+
+IOEngine::Batch::~Batch()
+{
+  try
+  {
+    engine.impl->endBatch();
+  }
+  catch(...) // the requests stay in the ring and go with the next submission
+  {}
+}
+
+
+
+
+
+
+AsyncFile::AsyncFile(IOEngine & engineArg, std::string const & fileNameArg, Mode mode):engine(engineArg),
+  fileName(fileNameArg), fd(-1), fixedSlot(-1)
+{
+  int flags = O_CLOEXEC;
+  switch(mode)
+  {
+    case readOnly:  flags |= O_RDONLY; break;
+    case writeOnly: flags |= O_WRONLY | O_CREAT | O_TRUNC; break;
+    case readWrite: flags |= O_RDWR | O_CREAT; break;
+  }
+  fd = ::open(fileName.c_str(), flags, 0644);
+  if(fd < 0)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::open, fileName + ": " + std::generic_category().message(errno)));
+  fixedSlot = engine.impl->registerFile(fd);
+}
+
+
+
+AsyncFile::~AsyncFile()
+{
+  if(fixedSlot >= 0)
+    engine.impl->unregisterFile(fixedSlot);
+  ::close(fd);
+}
+
+
+
+boost::uint64_t AsyncFile::size() const
+{
+  struct stat info;
+  if(::fstat(fd, &info) < 0)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::access, fileName + ": " + std::generic_category().message(errno)));
+  return boost::uint64_t(info.st_size);
+}
+
+
+
+void AsyncFile::read(void * buffer, std::size_t bytes, boost::uint64_t offset, IOEngine::Callback callback)
+{
+  engine.impl->issue(Request::read, *this, fd, fixedSlot, buffer, bytes, offset, std::move(callback));
+}
+
+
+
+void AsyncFile::write(void const * buffer, std::size_t bytes, boost::uint64_t offset, IOEngine::Callback callback)
+{
+  engine.impl->issue(Request::write, *this, fd, fixedSlot, const_cast<void *>(buffer), bytes, offset,
+                     std::move(callback));
+}
+
+
+
+void AsyncFile::sync(IOEngine::Callback callback)
+{
+  engine.impl->issue(Request::sync, *this, fd, fixedSlot, 0, 0, 0, std::move(callback));
+}
+
+
+
+
+
+#ifdef UENF_ASYNCIO_COROUTINES
+
+void AsyncFile::Awaitable::await_suspend(std::coroutine_handle<> handle)
+{
+  Awaitable * self = this;
+  IOEngine::Callback resume = [self, handle](Expected<std::size_t> const & r) { self->result = r; handle.resume(); };
+  switch(operation)
+  {
+    case readOperation:  file.read(buffer, bytes, offset, std::move(resume)); break;
+    case writeOperation: file.write(buffer, bytes, offset, std::move(resume)); break;
+    case syncOperation:  file.sync(std::move(resume)); break;
+  }
+}
+
+
+
+void DetachedTask::promise_type::unhandled_exception() const noexcept
+{
+  try
+  {
+    Log::log("DetachedTask: unhandled exception:\n" + boost::current_exception_diagnostic_information(), Log::error);
+  }
+  catch(...)
+  {}
+}
+
+#endif
+
+
+
+
+} // end of namespace uenf
@@ -0,0 +1,211 @@
+#ifndef UENF_ASYNCIO_H
+#define UENF_ASYNCIO_H
+
+
+#include <uenf/Exceptions.h>
+#include <uenf/Expected.h>
+#include <uenf/SmallFunction.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <string>
+#include <cstddef>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+  #include <coroutine>
+  #define UENF_ASYNCIO_COROUTINES
+#endif
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  Asynchronous file I/O: one thread can keep hundreds of reads and writes in flight instead of blocking in each.
+  On Linux the engine uses io_uring, where that is not available (old kernel, seccomp policy, other systems) a pool
+  of threads doing blocking pread()/pwrite() calls instead, with the same interface.
+
+    IOEngine engine;
+    AsyncFile file(engine, "frames.raw", AsyncFile::readOnly);
+
+    // callback API, the callback runs on the completion thread of the engine
+    file.read(buffer, bytes, offset, [](Expected<std::size_t> const & r)
+    {
+      if(r) ... *r bytes read (less than requested at the end of the file)
+      else  ... r.error().raise() throws the ExceptionIO
+    });
+
+    // coroutine API (C++20), throws an ExceptionIO on failure
+    std::size_t n = co_await file.read(buffer, bytes, offset);
+
+  Requests are submitted right away, unless they are issued within the scope of an IOEngine::Batch, which
+  submits them all at once with a single system call at its end (or earlier, when a request has to wait for a free
+  slot of the queue depth). Memory registered via registerBuffers() is
+  pinned by the kernel once, reads and writes into it skip the per request mapping (io_uring only, the fallback
+  ignores registrations). Files are registered in the fixed file table of the ring automatically (as long as it
+  has free slots), which saves a file table lookup per request.
+
+  Buffers must stay valid until the request completed. Completion callbacks and resumed coroutines run on the
+  completion thread of the engine (or a pool thread of the fallback), they should hand longer work to another
+  thread, for example by posting it to an EventLoop. Failures are reported as ExceptionIO with the spec of the
+  operation (open, read, write, access for sync) and the file name plus the system error text as name.
+*/
+class IOEngine : boost::noncopyable
+{
+public:
+  enum Backend { automatic, ioUring, threadPool };
+
+  typedef SmallFunction<void (Expected<std::size_t> const & result)> Callback;
+
+  /*! queueDepth is the number of requests in flight at most (more block until some complete, those issued by
+      completion callbacks are queued instead and submitted as slots free up), fallbackThreads the size of the
+      thread pool if io_uring is not used. Asking for ioUring explicitly throws an ExceptionRuntime if it is not
+      available.
+  */
+  explicit IOEngine(unsigned int queueDepth = 256, Backend backend = automatic, unsigned int fallbackThreads = 4);
+  //! waits for all requests in flight
+  ~IOEngine();
+
+  Backend backend() const;
+
+  /*! registers memory for faster I/O, replacing earlier registrations, must not be called with requests in flight
+      (throws an ExceptionCode then)
+  */
+  void registerBuffers(void * const * buffers, std::size_t const * sizes, std::size_t count);
+  void unregisterBuffers();
+
+  //! blocks until no more requests are in flight
+  void drain();
+
+  //! defers submission of the requests issued by any thread until the last Batch of the engine ends
+  class Batch : boost::noncopyable
+  {
+  public:
+    explicit Batch(IOEngine & engineArg);
+    ~Batch();
+  private:
+    IOEngine & engine;
+  };
+
+  class Implementation; // io_uring or thread pool, see AsyncIO.cpp
+
+private:
+  friend class AsyncFile;
+  boost::scoped_ptr<Implementation> impl;
+};
+
+
+
+
+class AsyncFile : boost::noncopyable
+{
+public:
+  enum Mode { readOnly, writeOnly, readWrite };
+
+  //! throws an ExceptionIO (open) if the file cannot be opened, writeOnly creates or truncates the file
+  AsyncFile(IOEngine & engine, std::string const & fileName, Mode mode = readOnly);
+  //! the file must not have requests in flight any more
+  ~AsyncFile();
+
+  std::string const & name() const { return fileName; }
+  //! throws an ExceptionIO (access)
+  boost::uint64_t size() const;
+
+  //! like pread()/pwrite(), a request may transfer less than asked for (at most 2 GiB - 4 KiB)
+  void read (void * buffer,       std::size_t bytes, boost::uint64_t offset, IOEngine::Callback callback);
+  void write(void const * buffer, std::size_t bytes, boost::uint64_t offset, IOEngine::Callback callback);
+  //! the result is 0 on success
+  void sync(IOEngine::Callback callback);
+
+#ifdef UENF_ASYNCIO_COROUTINES
+  //! co_await yields the number of bytes transferred, or throws the ExceptionIO
+  class Awaitable
+  {
+  public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    std::size_t await_resume() const { return result.value(); }
+
+  private:
+    friend class AsyncFile;
+    enum Operation { readOperation, writeOperation, syncOperation };
+    Awaitable(AsyncFile & fileArg, Operation operationArg, void * bufferArg, std::size_t bytesArg,
+              boost::uint64_t offsetArg):file(fileArg), operation(operationArg), buffer(bufferArg), bytes(bytesArg),
+      offset(offsetArg), result(Error()) {}
+
+    AsyncFile & file;
+    Operation const operation;
+    void * const buffer;
+    std::size_t const bytes;
+    boost::uint64_t const offset;
+    Expected<std::size_t> result;
+  };
+
+  Awaitable read (void * buffer,       std::size_t bytes, boost::uint64_t offset)
+  {
+    return Awaitable(*this, Awaitable::readOperation, buffer, bytes, offset);
+  }
+  Awaitable write(void const * buffer, std::size_t bytes, boost::uint64_t offset)
+  {
+    return Awaitable(*this, Awaitable::writeOperation, const_cast<void *>(buffer), bytes, offset);
+  }
+  Awaitable sync()
+  {
+    return Awaitable(*this, Awaitable::syncOperation, 0, 0, 0);
+  }
+#endif
+
+private:
+  IOEngine & engine;
+  std::string const fileName;
+  int fd;
+  int fixedSlot; // index in the fixed file table of the ring, -1 if none
+};
+
+
+
+
+#ifdef UENF_ASYNCIO_COROUTINES
+/*!
+  The simplest coroutine type to use the awaitables with: starts running immediately and is not awaited by anyone.
+  An exception leaving the coroutine is logged as error (there is nobody to report it to).
+
+    DetachedTask copyFile(AsyncFile & in, AsyncFile & out, char * buffer, std::size_t size)
+    {
+      for(boost::uint64_t offset = 0; ; offset += size)
+      {
+        std::size_t n = co_await in.read(buffer, size, offset);
+        co_await out.write(buffer, n, offset);
+        if(n < size)
+          break;
+      }
+    }
+*/
+struct DetachedTask
+{
+  struct promise_type
+  {
+    DetachedTask get_return_object() noexcept { return DetachedTask(); }
+    std::suspend_never initial_suspend() const noexcept { return std::suspend_never(); }
+    std::suspend_never final_suspend() const noexcept { return std::suspend_never(); }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept;
+  };
+};
+#endif
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,189 @@
+
+
+
+#include <uenf/EventLoop.h>
+
+#include <boost/thread/locks.hpp>
+
+#include <ciso646>
+
+
+namespace uenf
+{
+
+
+
+EventLoop::EventLoop(EventTarget * ownerArg):owner(ownerArg), nodes(new Node[pooledNodes]), freeNodes(1), head(0),
+                                             sleeping(false), processedCount(0)
+{
+  for(int i = 0; i < pooledNodes; ++i)
+  {
+    nodes[i].pooled = true;
+    nodes[i].nextFree.store(i + 1 < pooledNodes ? i + 2 : 0, boost::memory_order_relaxed);
+  }
+}
+
+
+
+EventLoop::~EventLoop()
+{
+  stopAndWaitForThreadToExit();
+  recycleNodes(head.exchange(0));
+}
+
+
+
+void EventLoop::postEvent(Event event)
+{
+  Node * node = takeNode();
+  node->event = std::move(event);
+  node->next = head.load(boost::memory_order_relaxed);
+  while(not head.compare_exchange_weak(node->next, node, boost::memory_order_seq_cst, boost::memory_order_relaxed))
+  {}
+
+  // Pairs with waitForEvents(): either the loop sees our node before it sleeps, or we see it sleeping here.
+  if(sleeping.load())
+  {
+    boost::lock_guard<boost::mutex> guard(wakeupMutex);
+    wakeup.notify_one();
+  }
+}
+
+
+
+void EventLoop::stopThread()
+{
+  ThreadedObject::stopThread();
+  boost::lock_guard<boost::mutex> guard(wakeupMutex);
+  wakeup.notify_one();
+}
+
+
+
+void EventLoop::run()
+{
+  while(not stop)
+  {
+    if(not processEvents())
+      waitForEvents();
+  }
+  processEvents(); // the ones posted before stopping
+}
+
+
+
+std::size_t EventLoop::processEvents()
+{
+  Node * batch = head.exchange(0, boost::memory_order_acquire);
+  if(not batch)
+    return 0;
+
+  // the stack holds the newest event first, reverse it to process in posting order
+  Node * ordered = 0;
+  while(batch)
+  {
+    Node * next = batch->next;
+    batch->next = ordered;
+    ordered = batch;
+    batch = next;
+  }
+
+  // recycles the rest of the batch, if reportException() throws
+  struct Pending
+  {
+    Pending(EventLoop & loopArg, Node * nodesArg):loop(loopArg), nodes(nodesArg) {}
+    ~Pending() { loop.recycleNodes(nodes); }
+    EventLoop & loop;
+    Node * nodes;
+  } pending(*this, ordered);
+
+  std::size_t count = 0;
+  while(pending.nodes)
+  {
+    Node * done = pending.nodes;
+    try
+    {
+      done->event();
+    }
+    catch(...)
+    {
+      reportException(boost::current_exception());
+    }
+    pending.nodes = done->next;
+    done->next = 0;
+    recycleNodes(done);
+    ++count;
+  }
+  processedCount.fetch_add(count, boost::memory_order_relaxed);
+  return count;
+}
+
+
+
+void EventLoop::waitForEvents()
+{
+  boost::unique_lock<boost::mutex> lock(wakeupMutex);
+  sleeping = true;
+  while(not head.load() and not stop)
+    wakeup.wait(lock);
+  sleeping = false;
+}
+
+
+
+void EventLoop::reportException(boost::exception_ptr const & e)
+{
+  if(owner)
+  {
+    try
+    {
+      owner->postEvent([e]() { boost::rethrow_exception(e); });
+      return;
+    }
+    catch(...) // could not post, keep it ourselves
+    {}
+  }
+  ThreadedObject::reportException(e);
+}
+
+
+
+EventLoop::Node * EventLoop::takeNode()
+{
+  boost::uint64_t top = freeNodes.load(boost::memory_order_acquire);
+  while(boost::uint32_t const index = boost::uint32_t(top))
+  {
+    boost::uint64_t const next = ((top >> 32) + 1) << 32 | nodes[index - 1].nextFree.load(boost::memory_order_relaxed);
+    if(freeNodes.compare_exchange_weak(top, next, boost::memory_order_acquire, boost::memory_order_acquire))
+      return &nodes[index - 1];
+  }
+  return new Node; // the pool is exhausted
+}
+
+
+
+void EventLoop::recycleNodes(Node * node)
+{
+  while(node)
+  {
+    Node * next = node->next;
+    node->event.reset();
+    if(node->pooled)
+    {
+      boost::uint32_t const index = boost::uint32_t(node - &nodes[0]) + 1;
+      boost::uint64_t top = freeNodes.load(boost::memory_order_relaxed);
+      do
+        node->nextFree.store(boost::uint32_t(top), boost::memory_order_relaxed);
+      while(not freeNodes.compare_exchange_weak(top, ((top >> 32) + 1) << 32 | index, boost::memory_order_release,
+                                                boost::memory_order_relaxed));
+    }
+    else
+      delete node;
+    node = next;
+  }
+}
+
+
+
+
+} // end of namespace uenf
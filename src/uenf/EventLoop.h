@@ -0,0 +1,106 @@
+#ifndef UENF_EVENTLOOP_H
+#define UENF_EVENTLOOP_H
+
+
+#include <uenf/ThreadedObject.h>
+#include <uenf/EventTarget.h>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  A ThreadedObject running an event loop: events (callables) posted from any thread are executed in order on the
+  thread of the loop (see doc/ev_q_ex_handling.txt).
+
+    EventLoop loop;
+    loop.startThread();
+    loop.postEvent(boost::bind(&Model::load, &model, fileName));
+
+  Posting takes a node from a pool of the loop and pushes it onto a lock-free stack, a compare-and-swap each and
+  no allocation; only while more than pooledNodes events are pending (or being processed) further nodes come
+  from the heap. The mutex is only touched to wake the loop, if it is actually sleeping. Upon wakeup, the loop
+  takes all pending events at once and processes them as one batch, and returns the nodes to the pool.
+
+  An exception thrown by an event does not stop the loop. It is forwarded to the owner: if an owner EventTarget
+  was given, the exception is rethrown in an event of the owner (and thus reaches the owner of the owner, if that
+  is an EventLoop, too), otherwise it is kept for takePendingException() like the exceptions of any ThreadedObject.
+
+  Events posted before stopThread() are still processed, events posted later are destroyed unprocessed.
+  Derived classes overriding run() have to call processEvents() and waitForEvents() themselves, and like any
+  derived class need to call stopAndWaitForThreadToExit() in their destructor.
+*/
+class EventLoop : public ThreadedObject, public EventTarget
+{
+public:
+  explicit EventLoop(EventTarget * ownerArg = 0);
+  ~EventLoop();
+
+  //! thread-safe
+  void postEvent(Event event);
+
+  void stopThread();
+
+  //! number of events processed so far (for diagnostics)
+  std::size_t processedEvents() const { return processedCount.load(boost::memory_order_relaxed); }
+
+protected:
+  void run();
+
+  //! processes all events pending right now, returns their number
+  std::size_t processEvents();
+
+  //! blocks until an event is posted or the thread is stopped
+  void waitForEvents();
+
+  void reportException(boost::exception_ptr const & e);
+
+private:
+  enum { pooledNodes = 256 };
+
+  struct Node
+  {
+    Node():next(0), nextFree(0), pooled(false) {}
+    Event event;
+    Node * next;
+    boost::atomic<boost::uint32_t> nextFree; // in the pool: index + 1 of the next free node, 0 at the end
+    bool pooled;
+  };
+
+  Node * takeNode();
+  void recycleNodes(Node * node); // nothrow, destroys the events and returns the nodes to the pool
+
+  EventTarget * owner;
+
+  boost::scoped_array<Node> nodes;
+  // the free pooled nodes: index + 1 of the first one in the low 32 bits, a modification count against ABA above
+  boost::atomic<boost::uint64_t> freeNodes;
+
+  boost::atomic<Node *> head;   // the pending events in reverse order
+  boost::atomic<bool> sleeping; // the loop is waiting (or about to) on the condition variable
+
+  boost::mutex wakeupMutex;
+  boost::condition_variable wakeup;
+
+  boost::atomic<std::size_t> processedCount;
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef UENF_EVENTTARGET_H
+#define UENF_EVENTTARGET_H
+
+
+#include <uenf/SmallFunction.h>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  Something with an event loop that events (callables) can be posted to from any thread, they will be executed
+  later on the thread of the target. Used for example by queued signal connections (see Signal.h).
+*/
+class EventTarget
+{
+public:
+  typedef SmallFunction<void ()> Event;
+
+  //! must be thread-safe
+  virtual void postEvent(Event event) = 0;
+
+protected:
+  ~EventTarget() {}
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -4,7 +4,10 @@
 
 // we use boost exception here and only define some special types
 #include <boost/exception/all.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/atomic.hpp>
 #include <string>
+#include <ciso646>
 
 
 
@@ -15,10 +18,54 @@ namespace uenf
 
 
 // the following class and the typedef is right from the example on the boost website
+//
+// Additionally, what() returns a description of the error, which derived classes produce in describe()
+// from their compactly stored members. It is only formatted upon the first call of what() (which includes
+// boost::diagnostic_information()), so throwing an exception that is caught and handled right away never
+// pays for string concatenation. Exceptions travel between threads (see ThreadedObject.h), so the formatted
+// description is published with a compare-and-swap: concurrent first calls may both format, one of them wins.
+// Nothing is attached as boost error_info by the classes of this file, the user is free to add error_info as
+// before.
 class ExceptionBase: virtual public std::exception, virtual public boost::exception
 {
 public:
-	~ExceptionBase() throw() {}
+  ExceptionBase():description(0) {}
+  // the copy formats its own description, if asked
+  ExceptionBase(ExceptionBase const & other):std::exception(other), boost::exception(other), description(0) {}
+	~ExceptionBase() throw() { delete description.load(boost::memory_order_acquire); }
+
+  char const * what() const throw()
+  {
+    std::string const * formatted = description.load(boost::memory_order_acquire);
+    if(not formatted)
+    {
+      std::string * mine = 0;
+      try
+      {
+        mine = new std::string;
+        describe(*mine);
+      }
+      catch(...) // out of memory, at least give the type
+      {
+        delete mine;
+        return "uenf::ExceptionBase (description failed)";
+      }
+      if(description.compare_exchange_strong(formatted, mine, boost::memory_order_acq_rel,
+                                             boost::memory_order_acquire))
+        formatted = mine;
+      else
+        delete mine; // another thread was faster, formatted is its description
+    }
+    return formatted->c_str();
+  }
+
+protected:
+  virtual void describe(std::string & out) const { out = "uenf::ExceptionBase"; }
+
+private:
+  ExceptionBase & operator=(ExceptionBase const &); // not implemented
+
+  mutable boost::atomic<std::string const *> description; // lazily formatted by what()
 };
 
 class TaguenfException {};
@@ -47,7 +94,8 @@ typedef boost::error_info<TaguenfException, std::string> ExceptionStringInfo;
 //
 //  ... for more info, consider the boost exception webpages
 //
-//
+//  On paths where failures are routine (parsing, retries), consider returning an Expected<T> instead
+//  (see Expected.h), which maps one-to-one onto the classes below and can be turned into a throw.
 //
 //
 // ################################################################################################
@@ -71,38 +119,32 @@ public:
   /*! You can specify more in detail what went wrong (default is "open") and
       give a name identifying the ressource.
   */
-  ExceptionIO(Spec detail = open, std::string const & name = "<Unknown>")
+  ExceptionIO(Spec detail = open, std::string const & nameArg = "<Unknown>"):spec(detail), name(nameArg)
   {
-    switch(detail)
-    {
-      case open:
-        (*this) << (ExceptionStringInfo(std::string("Open failed with: ") + name));
-        break;
-
-      case read:
-        (*this) << (ExceptionStringInfo(std::string("Read failed on: ") + name));
-        break;
-
-      case parse:
-        (*this) << (ExceptionStringInfo(std::string("Parse error in: ") + name));
-        break;
-
-      case write:
-        (*this) << (ExceptionStringInfo(std::string("Write failed on: ") + name));
-        break;
-
-      case access:
-        (*this) << (ExceptionStringInfo(std::string("Access was wrong with: ") + name));
-        break;
-
-      default:  // we do not throw here (, although we could?)
-        (*this) << (ExceptionStringInfo(std::string("Unknown IO error with name: ") + name));
-        break;
-    }
   }
   ~ExceptionIO() throw()
   {
   }
+
+  static void describe(Spec detail, std::string const & name, std::string & out)
+  {
+    switch(detail)
+    {
+      case open:   out = "Open failed with: ";      break;
+      case read:   out = "Read failed on: ";        break;
+      case parse:  out = "Parse error in: ";        break;
+      case write:  out = "Write failed on: ";       break;
+      case access: out = "Access was wrong with: "; break;
+      default:     out = "Unknown IO error with name: "; break; // we do not throw here (, although we could?)
+    }
+    out += name;
+  }
+
+  Spec const spec;
+  std::string const name;
+
+protected:
+  void describe(std::string & out) const { describe(spec, name, out); }
 };
 
 
@@ -119,14 +161,20 @@ public:
   // by default, the first parameter was wrong (for typical 1-parameter functions)
   ExceptionParameter(int parameterNrArg = 0):parameterNr(parameterNrArg)
   {
-    (*this) << ExceptionStringInfo(std::string("Error in parameter nr. "))
-            << boost::error_info<TaguenfException, const int>(parameterNrArg);
   }
   const int parameterNr;
 
   ~ExceptionParameter() throw()
   {
   }
+
+  static void describe(int parameterNr, std::string & out)
+  {
+    out = "Error in parameter nr. " + boost::lexical_cast<std::string>(parameterNr);
+  }
+
+protected:
+  void describe(std::string & out) const { describe(parameterNr, out); }
 };
 
 
@@ -143,16 +191,27 @@ class ExceptionCode : virtual public ExceptionBase
 public:
   ExceptionCode()
   {
-    (*this) << (ExceptionStringInfo("Some programmer did write screwed code or this hardware sucks!"));
   }
 
-  ExceptionCode(std::string const & message)
+  ExceptionCode(std::string const & messageArg):message(messageArg)
   {
-    (*this) << (ExceptionStringInfo(std::string("Some programmer did write screwed code and gave this message: ") + message));
   }
   ~ExceptionCode() throw()
   {
   }
+
+  static void describe(std::string const & message, std::string & out)
+  {
+    if(message.empty())
+      out = "Some programmer did write screwed code or this hardware sucks!";
+    else
+      out = "Some programmer did write screwed code and gave this message: " + message;
+  }
+
+  std::string const message;
+
+protected:
+  void describe(std::string & out) const { describe(message, out); }
 };
 
 
@@ -166,16 +225,27 @@ class ExceptionRuntime : virtual public ExceptionBase
 public:
   ExceptionRuntime()
   {
-    (*this) << (ExceptionStringInfo("A runtime error occured."));
   }
 
-  ExceptionRuntime(std::string const & message)
+  ExceptionRuntime(std::string const & messageArg):message(messageArg)
   {
-    (*this) << (ExceptionStringInfo(std::string("A runtime error occured, detail: ") + message));
   }
   ~ExceptionRuntime() throw()
   {
   }
+
+  static void describe(std::string const & message, std::string & out)
+  {
+    if(message.empty())
+      out = "A runtime error occured.";
+    else
+      out = "A runtime error occured, detail: " + message;
+  }
+
+  std::string const message;
+
+protected:
+  void describe(std::string & out) const { describe(message, out); }
 };
 
 
@@ -0,0 +1,299 @@
+#ifndef UENF_EXPECTED_H
+#define UENF_EXPECTED_H
+
+
+#include <uenf/Exceptions.h>
+
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <ciso646>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  An error as a plain value, mapping one-to-one onto the exception classes of Exceptions.h: it carries the
+  same (compact) data as the corresponding exception and produces the same description, but costs no throw.
+  raise() throws the corresponding exception, fromCurrentException() goes the other way.
+*/
+class Error
+{
+public:
+  enum Kind { base, io, parameter, code, runtime };
+
+  //! corresponds to a plain ExceptionBase
+  Error():errorKind(base), spec(ExceptionIO::open), number(0) {}
+
+  static Error makeIO(ExceptionIO::Spec spec, std::string const & name = "<Unknown>") { return Error(io, spec, 0, name); }
+  static Error makeParameter(int parameterNr = 0) { return Error(parameter, ExceptionIO::open, parameterNr, std::string()); }
+  static Error makeCode(std::string const & message = std::string()) { return Error(code, ExceptionIO::open, 0, message); }
+  static Error makeRuntime(std::string const & message = std::string()) { return Error(runtime, ExceptionIO::open, 0, message); }
+
+  /*! To be called in a catch block: maps the caught uenf exception to an Error, other std::exceptions become a
+      runtime error with their what() as message, anything else a runtime error without message.
+  */
+  static Error fromCurrentException()
+  {
+    try
+    {
+      throw;
+    }
+    catch(ExceptionIO const & e)         { return makeIO(e.spec, e.name); }
+    catch(ExceptionParameter const & e)  { return makeParameter(e.parameterNr); }
+    catch(ExceptionCode const & e)       { return makeCode(e.message); }
+    catch(ExceptionRuntime const & e)    { return makeRuntime(e.message); }
+    catch(ExceptionBase const &)         { return Error(base, ExceptionIO::open, 0, std::string()); }
+    catch(std::exception const & e)      { return makeRuntime(e.what()); }
+    catch(...)                           { return makeRuntime(); }
+  }
+
+  Kind kind() const { return errorKind; }
+  ExceptionIO::Spec ioSpec() const { return spec; }
+  int parameterNr() const { return number; }
+  //! the name of the ressource (io) or the message (code, runtime)
+  std::string const & text() const { return errorText; }
+
+  //! the same text what() of the corresponding exception returns (formatted on each call)
+  std::string message() const
+  {
+    std::string out;
+    switch(errorKind)
+    {
+      case io:        ExceptionIO::describe(spec, errorText, out); break;
+      case parameter: ExceptionParameter::describe(number, out);   break;
+      case code:      ExceptionCode::describe(errorText, out);     break;
+      case runtime:   ExceptionRuntime::describe(errorText, out);  break;
+      default:        out = "uenf::ExceptionBase";                 break;
+    }
+    return out;
+  }
+
+  //! throws the exception corresponding to this error
+  void raise() const
+  {
+    switch(errorKind)
+    {
+      case io:        BOOST_THROW_EXCEPTION(ExceptionIO(spec, errorText));
+      case parameter: BOOST_THROW_EXCEPTION(ExceptionParameter(number));
+      case code:      BOOST_THROW_EXCEPTION(errorText.empty() ? ExceptionCode() : ExceptionCode(errorText));
+      case runtime:   BOOST_THROW_EXCEPTION(errorText.empty() ? ExceptionRuntime() : ExceptionRuntime(errorText));
+      default:        BOOST_THROW_EXCEPTION(ExceptionBase());
+    }
+  }
+
+private:
+  Error(Kind kindArg, ExceptionIO::Spec specArg, int numberArg, std::string const & textArg):
+    errorKind(kindArg), spec(specArg), number(numberArg), errorText(textArg) {}
+
+  Kind errorKind;
+  ExceptionIO::Spec spec;
+  int number;
+  std::string errorText;
+};
+
+
+
+
+
+
+/*!
+  Either a value of type T or an error (by default an Error), a non-throwing alternative for functions that fail
+  routinely. Both a value and an error convert implicitly:
+
+    Expected<Header> parseHeader(std::string const & fileName)
+    {
+      ...
+      if(magic not_eq expectedMagic)
+        return Error::makeIO(ExceptionIO::parse, fileName);
+      return header;
+    }
+
+    Expected<Header> h = parseHeader(fileName);
+    if(not h)
+      ... retry, or h.error().raise() to get the usual exception
+
+  Accessing the value of an Expected holding an error throws the corresponding exception. Assignments are
+  exception safe (the target keeps its old content, if a move or copy throws) as long as T or E can be moved
+  without throwing, which Error can.
+*/
+template<typename T, typename E = Error> class Expected
+{
+  static_assert(std::is_nothrow_move_constructible<T>::value or std::is_nothrow_move_constructible<E>::value,
+                "Expected<T, E> needs T or E to be nothrow move constructible");
+
+  enum
+  {
+    nothrowMove = std::is_nothrow_move_constructible<T>::value and std::is_nothrow_move_constructible<E>::value,
+    nothrowMoveAssign = nothrowMove and std::is_nothrow_move_assignable<T>::value and
+                        std::is_nothrow_move_assignable<E>::value
+  };
+
+public:
+  Expected(T const & value):valid(true) { new (&storage.value) T(value); }
+  Expected(T && value):valid(true) { new (&storage.value) T(std::move(value)); }
+  Expected(E const & error):valid(false) { new (&storage.error) E(error); }
+  Expected(E && error):valid(false) { new (&storage.error) E(std::move(error)); }
+
+  Expected(Expected const & other):valid(other.valid)
+  {
+    if(valid) new (&storage.value) T(other.storage.value);
+    else      new (&storage.error) E(other.storage.error);
+  }
+
+  Expected(Expected && other) noexcept(nothrowMove):valid(other.valid)
+  {
+    if(valid) new (&storage.value) T(std::move(other.storage.value));
+    else      new (&storage.error) E(std::move(other.storage.error));
+  }
+
+  Expected & operator=(Expected const & other)
+  {
+    if(this not_eq &other)
+    {
+      Expected copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  Expected & operator=(Expected && other) noexcept(nothrowMoveAssign)
+  {
+    if(this == &other)
+      return *this;
+    if(valid and other.valid)
+      storage.value = std::move(other.storage.value);
+    else if(not valid and not other.valid)
+      storage.error = std::move(other.storage.error);
+    else if(other.valid)
+    {
+      replace(storage.error, storage.value, other.storage.value);
+      valid = true;
+    }
+    else
+    {
+      replace(storage.value, storage.error, other.storage.error);
+      valid = false;
+    }
+    return *this;
+  }
+
+  ~Expected() { destroy(); }
+
+  bool hasValue() const { return valid; }
+  explicit operator bool() const { return valid; }
+
+  T       & value()       { check(); return storage.value; }
+  T const & value() const { check(); return storage.value; }
+
+  T       & operator*()        { return value(); }
+  T const & operator*()  const { return value(); }
+  T       * operator->()       { return &value(); }
+  T const * operator->() const { return &value(); }
+
+  template<typename U> T valueOr(U && fallback) const { return valid ? storage.value : T(std::forward<U>(fallback)); }
+
+  //! only valid, if there is no value
+  E const & error() const
+  {
+    if(valid)
+      BOOST_THROW_EXCEPTION(ExceptionCode("Expected::error() called on a value"));
+    return storage.error;
+  }
+
+private:
+  void check() const
+  {
+    if(not valid)
+      storage.error.raise();
+  }
+
+  void destroy()
+  {
+    if(valid) storage.value.~T();
+    else      storage.error.~E();
+  }
+
+  /*! destroys current and moves source into target (the other member of the union), if that throws, current is
+      restored (moving it is nothrow then, see the static_assert above)
+  */
+  template<typename Current, typename Target> static void replace(Current & current, Target & target, Target & source)
+  {
+    if(std::is_nothrow_move_constructible<Target>::value)
+    {
+      current.~Current();
+      new (&target) Target(std::move(source));
+    }
+    else
+    {
+      Current saved(std::move(current));
+      current.~Current();
+      try
+      {
+        new (&target) Target(std::move(source));
+      }
+      catch(...)
+      {
+        new (&current) Current(std::move(saved));
+        throw;
+      }
+    }
+  }
+
+  union Storage
+  {
+    Storage() {}
+    ~Storage() {}
+    T value;
+    E error;
+  } storage;
+  bool valid;
+};
+
+
+
+
+//! Expected without a value, just success or an error.
+template<typename E> class Expected<void, E>
+{
+public:
+  Expected():valid(true) {}
+  Expected(E const & errorArg):valid(false), err(errorArg) {}
+
+  bool hasValue() const { return valid; }
+  explicit operator bool() const { return valid; }
+
+  //! throws the corresponding exception on error
+  void value() const
+  {
+    if(not valid)
+      err.raise();
+  }
+
+  E const & error() const
+  {
+    if(valid)
+      BOOST_THROW_EXCEPTION(ExceptionCode("Expected::error() called on a value"));
+    return err;
+  }
+
+private:
+  bool valid;
+  E err;
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
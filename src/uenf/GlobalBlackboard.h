@@ -1,19 +1,100 @@
-$header
+#ifndef UENF_GLOBALBLACKBOARD_H
+#define UENF_GLOBALBLACKBOARD_H
 
+
+#include <uenf/Metrics.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <map>
+#include <string>
+#include <ciso646>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  A process wide, thread-safe place to put shared objects of type T under a name:
+
+    GlobalBlackboard<Calibration>::set("leftCamera", calibration);
+    ...
+    boost::shared_ptr<Calibration> c = GlobalBlackboard<Calibration>::get("leftCamera");
+
+  Lookups are counted as hits or misses (the metrics uenf.blackboard.hits and uenf.blackboard.misses, for all T).
+*/
 template<typename T> class GlobalBlackboard
 {
 public:
-  static boost::shared_ptr<T> & const operator[](std::string & const key) const
+  //! the entry for key, a null pointer if there is none
+  static boost::shared_ptr<T> get(std::string const & key)
   {
-    boost::guarded_lock(mutex);
-    return mapping[key];
+    boost::lock_guard<boost::mutex> guard(getMutex());
+    typename Mapping::const_iterator it = getMapping().find(key);
+    if(it == getMapping().end())
+    {
+      ++misses();
+      return boost::shared_ptr<T>();
+    }
+    ++hits();
+    return it->second;
   }
 
-  static boost::shared_ptr<T> & operator[](std::string & const key)
+  //! replaces an existing entry
+  static void set(std::string const & key, boost::shared_ptr<T> const & value)
   {
-    return mapping[key];
+    boost::lock_guard<boost::mutex> guard(getMutex());
+    getMapping()[key] = value;
+  }
+
+  //! returns false if there was no entry for key
+  static bool remove(std::string const & key)
+  {
+    boost::lock_guard<boost::mutex> guard(getMutex());
+    return getMapping().erase(key) > 0;
   }
 
 private:
-  static std::map<std::string, boost::shared_ptr<T> > mapping;
-};
\ No newline at end of file
+  typedef std::map<std::string, boost::shared_ptr<T> > Mapping;
+
+  // function statics instead of static members, so they exist before first use (see Log.cpp)
+  static Mapping & getMapping()
+  {
+    static Mapping mapping;
+    return mapping;
+  }
+
+  static boost::mutex & getMutex()
+  {
+    static boost::mutex mutex;
+    return mutex;
+  }
+
+  static Metrics::Counter & hits()
+  {
+    static Metrics::Counter & counter = Metrics::Registry::global().counter("uenf.blackboard.hits");
+    return counter;
+  }
+
+  static Metrics::Counter & misses()
+  {
+    static Metrics::Counter & counter = Metrics::Registry::global().counter("uenf.blackboard.misses");
+    return counter;
+  }
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -1,4 +1,210 @@
 // design rationale: now COW-Idiom here, is too complicated to get right and might lead to unexpected behaviour (that is, it
-// can cost the original owner(-thread) of the image cpu time in case he is first to modifiy the image and then needs to 
-// copy it. Also, a user would have to declare the copied image constant to avoid copies, if an access operator is invoked 
+// can cost the original owner(-thread) of the image cpu time in case he is first to modifiy the image and then needs to
+// copy it. Also, a user would have to declare the copied image constant to avoid copies, if an access operator is invoked
 // (even only for read access)
+
+#ifndef UENF_IMAGE_H
+#define UENF_IMAGE_H
+
+
+#include <uenf/Exceptions.h>
+#include <uenf/ImageAllocator.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <ciso646>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  A two-dimensional image with interleaved channels of type T (typically unsigned char, unsigned short or float).
+
+  Rows are padded to a multiple of rowAlignment bytes, so each row starts on an aligned address, which enables
+  vectorized row processing. The image either owns its memory or wraps memory owned by somebody else (like a
+  memory mapped file or a buffer of some driver), see the second constructor.
+
+  Copying is always explicit and deep (see doc/why_no_copy-on-write_images.txt). Resizing to a size that fits
+  into the already allocated memory does not reallocate, which lets long-running processing chains keep their
+  buffers across frames.
+
+  Owned memory comes from an ImageAllocator, by default the global BufferPool, which recycles buffers of freed
+  images. Temporary images of one frame can be placed in a FrameArena instead. Copies always use the default
+  allocator, so a copy never silently ends up in a frame-scoped arena.
+*/
+template<typename T> class Image
+{
+public:
+  typedef T ChannelType;
+
+  enum { rowAlignment = 32 };
+
+
+  explicit Image(ImageAllocator & allocatorArg = ImageAllocator::defaultAllocator()):
+    imageWidth(0), imageHeight(0), imageChannels(0), rowStride(0), pixels(0), capacity(0), owned(true),
+    allocator(&allocatorArg) {}
+
+  Image(int width, int height, int channels = 1, ImageAllocator & allocatorArg = ImageAllocator::defaultAllocator()):
+    imageWidth(0), imageHeight(0), imageChannels(0), rowStride(0), pixels(0), capacity(0), owned(true),
+    allocator(&allocatorArg)
+  {
+    resize(width, height, channels);
+  }
+
+  /*! Wraps foreign memory, nothing is copied or freed by this image. The stride is given in
+      elements of type T (not in bytes) and defaults to width * channels.
+  */
+  Image(T * data, int width, int height, int channels = 1, int stride = 0):
+    imageWidth(width), imageHeight(height), imageChannels(channels),
+    rowStride(stride ? stride : width * channels), pixels(data), capacity(0), owned(false), allocator(0)
+  {
+    if(width < 0 or height < 0 or channels < 1 or rowStride < width * channels)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(1));
+  }
+
+  Image(Image const & other):
+    imageWidth(0), imageHeight(0), imageChannels(0), rowStride(0), pixels(0), capacity(0), owned(true),
+    allocator(&ImageAllocator::defaultAllocator())
+  {
+    copyFrom(other);
+  }
+
+  Image & operator=(Image const & other)
+  {
+    if(this not_eq &other)
+      copyFrom(other);
+    return *this;
+  }
+
+  ~Image()
+  {
+    release();
+  }
+
+
+  /*! Changes the size of the image, the content is undefined afterwards. Memory is only reallocated, if the
+      new size does not fit into the current allocation. Wrapped foreign memory cannot be resized.
+  */
+  void resize(int width, int height, int channels = 1)
+  {
+    if(width < 0 or height < 0 or channels < 1)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(0));
+    if(width == imageWidth and height == imageHeight and channels == imageChannels)
+      return;
+    if(not owned)
+      BOOST_THROW_EXCEPTION(ExceptionCode("cannot resize an image wrapping foreign memory"));
+
+    int const stride = paddedStride(width * channels);
+    std::size_t const bytes = std::size_t(stride) * std::size_t(height) * sizeof(T);
+    if(bytes > capacity)
+    {
+      release();
+      pixels = static_cast<T *>(allocator->allocate(bytes));
+      capacity = bytes;
+      owned = true;
+    }
+    imageWidth = width;
+    imageHeight = height;
+    imageChannels = channels;
+    rowStride = stride;
+  }
+
+  //! Deep copy, reuses the current allocation if possible.
+  void copyFrom(Image const & other)
+  {
+    if(other.imageChannels == 0) // default constructed, keep our memory for later use
+    {
+      imageWidth = imageHeight = imageChannels = rowStride = 0;
+      return;
+    }
+    resize(other.width(), other.height(), other.channels());
+    std::size_t const rowBytes = std::size_t(imageWidth) * imageChannels * sizeof(T);
+    for(int y = 0; y < imageHeight; ++y)
+      std::memcpy(row(y), other.row(y), rowBytes);
+  }
+
+  void fill(T value)
+  {
+    for(int y = 0; y < imageHeight; ++y)
+      std::fill(row(y), row(y) + imageWidth * imageChannels, value);
+  }
+
+  void swap(Image & other)
+  {
+    std::swap(imageWidth,    other.imageWidth);
+    std::swap(imageHeight,   other.imageHeight);
+    std::swap(imageChannels, other.imageChannels);
+    std::swap(rowStride,     other.rowStride);
+    std::swap(pixels,        other.pixels);
+    std::swap(capacity,      other.capacity);
+    std::swap(owned,         other.owned);
+    std::swap(allocator,     other.allocator);
+  }
+
+
+  int  width()      const { return imageWidth;    }
+  int  height()     const { return imageHeight;   }
+  int  channels()   const { return imageChannels; }
+  //! distance between two rows in elements of T
+  int  stride()     const { return rowStride;     }
+  bool empty()      const { return imageWidth == 0 or imageHeight == 0; }
+  bool ownsMemory() const { return owned;         }
+
+  T       * data()       { return pixels; }
+  T const * data() const { return pixels; }
+
+  T       * row(int y)       { return pixels + std::ptrdiff_t(y) * rowStride; }
+  T const * row(int y) const { return pixels + std::ptrdiff_t(y) * rowStride; }
+
+  // unchecked access, use row() in inner loops
+  T       & operator()(int x, int y, int channel = 0)       { return row(y)[x * imageChannels + channel]; }
+  T const & operator()(int x, int y, int channel = 0) const { return row(y)[x * imageChannels + channel]; }
+
+
+private:
+  static int paddedStride(int elements)
+  {
+    int const perAlignment = rowAlignment % sizeof(T) ? 1 : int(rowAlignment / sizeof(T));
+    return (elements + perAlignment - 1) / perAlignment * perAlignment;
+  }
+
+  void release()
+  {
+    if(owned)
+      ImageAllocator::deallocate(pixels);
+    pixels = 0;
+    capacity = 0;
+    owned = true;
+    imageWidth = imageHeight = imageChannels = rowStride = 0;
+  }
+
+  int imageWidth;
+  int imageHeight;
+  int imageChannels;
+  int rowStride;
+  T * pixels;
+  std::size_t capacity; // in bytes, zero for foreign memory
+  bool owned;
+  ImageAllocator * allocator; // null for foreign memory
+};
+
+
+
+typedef Image<unsigned char>  ImageU8;
+typedef Image<unsigned short> ImageU16;
+typedef Image<float>          ImageF32;
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
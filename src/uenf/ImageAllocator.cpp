@@ -0,0 +1,474 @@
+
+
+
+#include <uenf/ImageAllocator.h>
+#include <uenf/Exceptions.h>
+
+#include <boost/align/aligned_alloc.hpp>
+#include <boost/thread/locks.hpp>
+
+#ifdef __linux__
+  #include <sys/mman.h>
+#endif
+
+#include <algorithm>
+#include <new>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+
+namespace
+{
+
+  enum BlockFlags { heapBlock = 0, mappedBlock = 1, hugePageBlock = 2 };
+
+  std::size_t const minClassShift = 12;                    // 4 KiB smallest size class
+  std::size_t const mapThreshold  = std::size_t(1) << 18;  // blocks from 256 KiB on are mmap'ed
+  std::size_t const hugePageSize  = std::size_t(1) << 21;
+
+  std::size_t roundUp(std::size_t value, std::size_t multiple)
+  {
+    return (value + multiple - 1) / multiple * multiple;
+  }
+
+}  // end of anonymous namespace
+
+
+
+
+
+
+void ImageAllocator::deallocate(void * buffer)
+{
+  if(not buffer)
+    return;
+  BlockHeader * header = headerOf(buffer);
+  header->owner->doDeallocate(header);
+}
+
+
+
+ImageAllocator & ImageAllocator::defaultAllocator()
+{
+  return BufferPool::global();
+}
+
+
+
+
+
+
+
+
+
+
+
+//! free blocks of one pool, cached for one thread (returned to the pool upon thread exit)
+struct BufferPool::ThreadCache
+{
+  explicit ThreadCache(BufferPool * poolArg):pool(poolArg), bytes(0) {}
+  ~ThreadCache()
+  {
+    release();
+  }
+
+  //! gives all blocks back to the shared free lists (or the operating system)
+  void release()
+  {
+    for(unsigned int c = 0; c < numSizeClasses; ++c)
+    {
+      for(std::size_t i = 0; i < blocks[c].size(); ++i)
+      {
+        pool->bytesCached -= blocks[c][i]->bytes;
+        pool->releaseToShared(blocks[c][i]);
+      }
+      blocks[c].clear();
+    }
+    bytes = 0;
+  }
+
+  BufferPool * pool;
+  std::vector<BlockHeader *> blocks[numSizeClasses];
+  std::size_t bytes; // in all blocks
+};
+
+
+void BufferPool::flushThreadCache(ThreadCache * cache)
+{
+  delete cache;
+}
+
+
+
+BufferPool::BufferPool(std::size_t maxCachedBytes, bool useHugePages, unsigned int threadCacheBlocks):
+  maxCached(maxCachedBytes), hugePages(useHugePages), threadCacheLimit(threadCacheBlocks),
+  threadCacheMaxBytes(maxCachedBytes / 8),
+  threadCache(&BufferPool::flushThreadCache),
+  bytesLive(0), bytesCached(0), bytesMapped(0), allocations(0), deallocations(0),
+  threadCacheHits(0), poolHits(0), poolMisses(0)
+{
+}
+
+
+
+BufferPool::~BufferPool()
+{
+  threadCache.reset(); // the cache of the destroying thread, the others must be gone already
+  trim();
+}
+
+
+
+BufferPool & BufferPool::global()
+{
+  // like the logger list in Log.cpp, this is a wanted leak
+  static BufferPool * poolPtr = new BufferPool;
+  return *poolPtr;
+}
+
+
+
+unsigned int BufferPool::sizeClassOf(std::size_t bytes)
+{
+  if(bytes <= (std::size_t(1) << minClassShift))
+    return 0;
+  // position of the highest bit below bytes - 1, plus two bits for the quarter steps
+  std::size_t const v = bytes - 1;
+  unsigned int shift = 0;
+  while((v >> shift) > 7)
+    ++shift;
+  // v >> shift is in [4, 7], that is the quarter step within the power of two 2^(shift + 2)
+  unsigned int const sizeClass = (shift + 2 - minClassShift) * 4 + unsigned(v >> shift) - 4 + 1;
+  return sizeClass < numSizeClasses ? sizeClass : unpooled;
+}
+
+
+
+std::size_t BufferPool::sizeOfClass(unsigned int sizeClass)
+{
+  if(sizeClass == 0)
+    return std::size_t(1) << minClassShift;
+  unsigned int const c = sizeClass - 1;
+  std::size_t const power = std::size_t(1) << (minClassShift + c / 4);
+  return power + (power / 4) * (c % 4 + 1);
+}
+
+
+
+std::size_t BufferPool::roundedSize(std::size_t bytes)
+{
+  unsigned int const sizeClass = sizeClassOf(bytes);
+  return sizeClass == unpooled ? bytes : sizeOfClass(sizeClass);
+}
+
+
+
+BufferPool::BlockHeader * BufferPool::mapBlock(std::size_t bytes, unsigned int sizeClass)
+{
+  std::size_t total = bytes + headerSize;
+  void * memory = 0;
+  unsigned int flags = heapBlock;
+
+#ifdef __linux__
+  if(total >= mapThreshold)
+  {
+    if(hugePages)
+    {
+      total = roundUp(total, hugePageSize);
+      memory = mmap(0, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if(memory == MAP_FAILED)
+        memory = 0;
+      else
+        flags = mappedBlock | hugePageBlock;
+    }
+    if(not memory)
+    {
+      total = roundUp(total, 4096);
+      memory = mmap(0, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if(memory == MAP_FAILED)
+        BOOST_THROW_EXCEPTION(ExceptionRuntime("mmap of image buffer failed"));
+      flags = mappedBlock;
+      if(hugePages) // no reserved huge pages available, at least ask for transparent ones
+        madvise(memory, total, MADV_HUGEPAGE);
+    }
+  }
+#endif
+
+  if(not memory)
+  {
+    memory = boost::alignment::aligned_alloc(alignment, total);
+    if(not memory)
+      BOOST_THROW_EXCEPTION(ExceptionRuntime("allocation of image buffer failed"));
+  }
+
+  bytesMapped += total;
+  BlockHeader * header = static_cast<BlockHeader *>(memory);
+  header->owner = this;
+  header->bytes = total - headerSize;
+  header->sizeClass = sizeClass;
+  header->flags = flags;
+  return header;
+}
+
+
+
+void BufferPool::unmapBlock(BlockHeader * header)
+{
+  std::size_t const total = header->bytes + headerSize;
+  bytesMapped -= total;
+#ifdef __linux__
+  if(header->flags & mappedBlock)
+  {
+    munmap(header, total);
+    return;
+  }
+#endif
+  boost::alignment::aligned_free(header);
+}
+
+
+
+void * BufferPool::doAllocate(std::size_t bytes)
+{
+  ++allocations;
+  unsigned int const sizeClass = sizeClassOf(bytes);
+  BlockHeader * header = 0;
+
+  if(sizeClass not_eq unpooled)
+  {
+    ThreadCache * cache = threadCache.get();
+    if(cache and not cache->blocks[sizeClass].empty())
+    {
+      header = cache->blocks[sizeClass].back();
+      cache->blocks[sizeClass].pop_back();
+      cache->bytes -= header->bytes;
+      ++threadCacheHits;
+    }
+    else
+    {
+      boost::unique_lock<boost::mutex> guard(freeListsMutex);
+      if(not freeLists[sizeClass].empty())
+      {
+        header = freeLists[sizeClass].back();
+        freeLists[sizeClass].pop_back();
+        ++poolHits;
+      }
+    }
+  }
+
+  if(header)
+    bytesCached -= header->bytes;
+  else
+  {
+    ++poolMisses;
+    header = mapBlock(sizeClass == unpooled ? bytes : sizeOfClass(sizeClass), sizeClass);
+  }
+
+  bytesLive += header->bytes;
+  return bufferOf(header);
+}
+
+
+
+void BufferPool::doDeallocate(BlockHeader * header)
+{
+  ++deallocations;
+  bytesLive -= header->bytes;
+
+  if(header->sizeClass == unpooled)
+  {
+    unmapBlock(header);
+    return;
+  }
+
+  // the thread cache counts against maxCached like the shared lists, large blocks never fit into it
+  try
+  {
+    ThreadCache * cache = threadCache.get();
+    if(not cache and threadCacheLimit)
+    {
+      cache = new ThreadCache(this);
+      threadCache.reset(cache);
+    }
+    if(cache and cache->blocks[header->sizeClass].size() < threadCacheLimit and
+       cache->bytes + header->bytes <= threadCacheMaxBytes and bytesCached + header->bytes <= maxCached)
+    {
+      cache->blocks[header->sizeClass].push_back(header);
+      cache->bytes += header->bytes;
+      bytesCached += header->bytes;
+      return;
+    }
+  }
+  catch(...) // this is a nothrow, without a cache we just go the shared way
+  {}
+
+  releaseToShared(header);
+}
+
+
+
+void BufferPool::releaseToShared(BlockHeader * header)
+{
+  if(bytesCached + header->bytes <= maxCached)
+  {
+    try
+    {
+      boost::unique_lock<boost::mutex> guard(freeListsMutex);
+      freeLists[header->sizeClass].push_back(header);
+      bytesCached += header->bytes;
+      return;
+    }
+    catch(...) // push_back failed, give the memory back instead
+    {}
+  }
+  unmapBlock(header);
+}
+
+
+
+void BufferPool::trim()
+{
+  if(ThreadCache * cache = threadCache.get())
+    cache->release();
+
+  std::vector<BlockHeader *> released;
+  {
+    boost::unique_lock<boost::mutex> guard(freeListsMutex);
+    for(unsigned int c = 0; c < numSizeClasses; ++c)
+    {
+      released.insert(released.end(), freeLists[c].begin(), freeLists[c].end());
+      freeLists[c].clear();
+    }
+  }
+  for(std::size_t i = 0; i < released.size(); ++i)
+  {
+    bytesCached -= released[i]->bytes;
+    unmapBlock(released[i]);
+  }
+}
+
+
+
+AllocatorStatistics BufferPool::statistics() const
+{
+  AllocatorStatistics s;
+  s.bytesLive       = bytesLive;
+  s.bytesCached     = bytesCached;
+  s.bytesMapped     = bytesMapped;
+  s.allocations     = allocations;
+  s.deallocations   = deallocations;
+  s.threadCacheHits = threadCacheHits;
+  s.poolHits        = poolHits;
+  s.poolMisses      = poolMisses;
+  return s;
+}
+
+
+
+
+
+
+
+
+
+
+
+FrameArena::FrameArena(std::size_t chunkBytes, BufferPool & upstream):
+  chunkSize(chunkBytes), pool(upstream), currentChunk(0), offset(0), usedBefore(0),
+  liveBuffers(0), allocationCount(0), deallocationCount(0), chunkAllocations(0)
+{
+}
+
+
+
+FrameArena::~FrameArena()
+{
+  for(std::size_t i = 0; i < chunks.size(); ++i)
+    ImageAllocator::deallocate(chunks[i].memory);
+}
+
+
+
+void * FrameArena::doAllocate(std::size_t bytes)
+{
+  std::size_t const needed = roundUp(bytes, alignment) + headerSize;
+
+  // go forward through the already owned chunks, then take a new one
+  while(currentChunk < chunks.size() and offset + needed > chunks[currentChunk].bytes)
+  {
+    usedBefore += offset;
+    offset = 0;
+    ++currentChunk;
+  }
+  if(currentChunk == chunks.size())
+  {
+    Chunk chunk;
+    chunk.bytes = std::max(chunkSize, needed);
+    chunk.memory = static_cast<char *>(pool.allocate(chunk.bytes));
+    chunks.push_back(chunk);
+    ++chunkAllocations;
+  }
+
+  BlockHeader * header = reinterpret_cast<BlockHeader *>(chunks[currentChunk].memory + offset);
+  header->owner = this;
+  header->bytes = needed - headerSize;
+  header->sizeClass = 0;
+  header->flags = 0;
+  offset += needed;
+
+  ++liveBuffers;
+  ++allocationCount;
+  return bufferOf(header);
+}
+
+
+
+void FrameArena::doDeallocate(BlockHeader *)
+{
+  --liveBuffers;
+  ++deallocationCount;
+}
+
+
+
+void FrameArena::reset()
+{
+#ifdef DEBUG
+  if(liveBuffers)
+    BOOST_THROW_EXCEPTION(ExceptionCode("FrameArena reset while buffers are still in use"));
+#endif
+  currentChunk = 0;
+  offset = 0;
+  usedBefore = 0;
+}
+
+
+
+std::size_t FrameArena::bytesUsed() const
+{
+  return usedBefore + offset;
+}
+
+
+
+AllocatorStatistics FrameArena::statistics() const
+{
+  AllocatorStatistics s;
+  s.bytesLive = bytesUsed();
+  for(std::size_t i = 0; i < chunks.size(); ++i)
+    s.bytesMapped += chunks[i].bytes;
+  s.bytesCached   = s.bytesMapped - s.bytesLive;
+  s.allocations   = allocationCount;
+  s.deallocations = deallocationCount;
+  s.poolHits      = allocationCount - chunkAllocations; // served from chunks the arena already had
+  s.poolMisses    = chunkAllocations;
+  return s;
+}
+
+
+
+
+} // end of namespace uenf
@@ -0,0 +1,225 @@
+#ifndef UENF_IMAGEALLOCATOR_H
+#define UENF_IMAGEALLOCATOR_H
+
+
+#include <boost/noncopyable.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <vector>
+#include <cstddef>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+//! Counters of an allocator, all values are a snapshot and may be slightly out of sync with each other.
+struct AllocatorStatistics
+{
+  AllocatorStatistics():bytesLive(0), bytesCached(0), bytesMapped(0), allocations(0), deallocations(0),
+                        threadCacheHits(0), poolHits(0), poolMisses(0) {}
+
+  std::size_t bytesLive;        //!< bytes handed out and not yet returned
+  std::size_t bytesCached;      //!< bytes kept in the pool for reuse
+  std::size_t bytesMapped;      //!< bytes currently obtained from the operating system
+  std::size_t allocations;
+  std::size_t deallocations;
+  std::size_t threadCacheHits;  //!< allocations served by the per-thread cache (no locking)
+  std::size_t poolHits;         //!< allocations served by the shared free lists (by owned chunks for FrameArena)
+  std::size_t poolMisses;       //!< allocations that needed fresh memory from the operating system (upstream)
+};
+
+
+
+
+/*!
+  Base class of all allocators for image buffers (see Image.h). Every buffer is preceded by a small header
+  naming the allocator it came from, so a buffer can be freed with the static deallocate() without knowing
+  its allocator and always returns to its owner, regardless of the thread freeing it.
+
+  Buffers are aligned to ImageAllocator::alignment bytes.
+*/
+class ImageAllocator : boost::noncopyable
+{
+public:
+  enum { alignment = 64 };
+
+  virtual ~ImageAllocator() {}
+
+  //! throws an ExceptionRuntime if no memory is available
+  void * allocate(std::size_t bytes) { return doAllocate(bytes); }
+
+  //! returns a buffer to the allocator it was allocated from, null is ignored (nothrow)
+  static void deallocate(void * buffer);
+
+  //! the global BufferPool, used by all images not given a specific allocator
+  static ImageAllocator & defaultAllocator();
+
+  virtual AllocatorStatistics statistics() const = 0;
+
+protected:
+  struct BlockHeader
+  {
+    ImageAllocator * owner;
+    std::size_t      bytes;      // usable bytes after the header
+    unsigned int     sizeClass;
+    unsigned int     flags;
+  };
+
+  // the header occupies a whole alignment unit, to keep the buffer behind it aligned
+  enum { headerSize = alignment };
+
+  static BlockHeader * headerOf(void * buffer)         { return reinterpret_cast<BlockHeader *>(static_cast<char *>(buffer) - headerSize); }
+  static void        * bufferOf(BlockHeader * header)  { return reinterpret_cast<char *>(header) + headerSize; }
+
+  virtual void * doAllocate(std::size_t bytes) = 0;
+  virtual void   doDeallocate(BlockHeader * header) = 0; // nothrow
+};
+
+
+
+
+
+
+/*!
+  A pool of aligned buffers sorted into size classes (four classes per power of two, starting at 4 KiB), so
+  freed buffers can be reused by later allocations of a similar size without going to the operating system.
+  Large buffers are mapped directly from the operating system (optionally backed by huge pages on Linux), which
+  avoids the fragmentation of the heap in long-running processes.
+
+  Each thread has a small cache of free buffers per pool and size class (at most threadCacheBlocks per class and
+  an eighth of maxCachedBytes in total), which is used without locking. Buffers freed by any thread go back to the
+  pool they were allocated from. A pool must outlive all threads that used it, which is no issue for the global
+  pool (ImageAllocator::defaultAllocator()), as it is never destroyed.
+
+  If more than maxCachedBytes would be kept idle (in the shared free lists and the thread caches together), freed
+  buffers are returned to the operating system instead.
+*/
+class BufferPool : public ImageAllocator
+{
+public:
+  explicit BufferPool(std::size_t maxCachedBytes = std::size_t(512) << 20, bool useHugePages = false,
+                      unsigned int threadCacheBlocks = 4);
+  ~BufferPool();
+
+  //! the process wide pool (a wanted leak, so it is usable during static destruction)
+  static BufferPool & global();
+
+  AllocatorStatistics statistics() const;
+
+  /*! returns all idle buffers of the shared free lists and the cache of the calling thread to the operating
+      system (the caches of other threads are released when those threads end)
+  */
+  void trim();
+
+  //! rounds a request up to the size that would really be reserved (mainly for diagnostics)
+  static std::size_t roundedSize(std::size_t bytes);
+
+protected:
+  void * doAllocate(std::size_t bytes);
+  void   doDeallocate(BlockHeader * header);
+
+private:
+  enum { numSizeClasses = 4 * 20, unpooled = 0xffffffff };
+
+  struct ThreadCache;
+  static void flushThreadCache(ThreadCache * cache);
+
+  static unsigned int sizeClassOf(std::size_t bytes);
+  static std::size_t  sizeOfClass(unsigned int sizeClass);
+
+  BlockHeader * mapBlock(std::size_t bytes, unsigned int sizeClass);
+  void          unmapBlock(BlockHeader * header);
+
+  void releaseToShared(BlockHeader * header);
+
+  std::size_t const maxCached;
+  bool const hugePages;
+  unsigned int const threadCacheLimit;
+  std::size_t const threadCacheMaxBytes;
+
+  mutable boost::mutex freeListsMutex;
+  std::vector<BlockHeader *> freeLists[numSizeClasses];
+
+  boost::thread_specific_ptr<ThreadCache> threadCache;
+
+  boost::atomic<std::size_t> bytesLive;
+  boost::atomic<std::size_t> bytesCached;
+  boost::atomic<std::size_t> bytesMapped;
+  boost::atomic<std::size_t> allocations;
+  boost::atomic<std::size_t> deallocations;
+  boost::atomic<std::size_t> threadCacheHits;
+  boost::atomic<std::size_t> poolHits;
+  boost::atomic<std::size_t> poolMisses;
+};
+
+
+
+
+
+
+/*!
+  Frame-scoped arena: allocations are bump allocations out of large chunks taken from a BufferPool, freeing a
+  single buffer does nothing, instead reset() makes all memory available again in O(1). Intended for temporary
+  images of one frame of a processing chain:
+
+    FrameArena arena;
+    while(grabFrame(frame))
+    {
+      Image<float> tmp(frame.width(), frame.height(), 1, arena);
+      ...
+      arena.reset(); // all images allocated from the arena must be gone by now
+    }
+
+  An arena is not thread-safe, use one per thread.
+*/
+class FrameArena : public ImageAllocator
+{
+public:
+  explicit FrameArena(std::size_t chunkBytes = std::size_t(64) << 20, BufferPool & upstream = BufferPool::global());
+  ~FrameArena();
+
+  //! in DEBUG builds, throws an ExceptionCode if buffers of the arena are still in use
+  void reset();
+
+  std::size_t bytesUsed() const;
+
+  AllocatorStatistics statistics() const;
+
+protected:
+  void * doAllocate(std::size_t bytes);
+  void   doDeallocate(BlockHeader * header);
+
+private:
+  struct Chunk
+  {
+    char * memory;
+    std::size_t bytes;
+  };
+
+  std::size_t const chunkSize;
+  BufferPool & pool;
+  std::vector<Chunk> chunks;
+  std::size_t currentChunk;
+  std::size_t offset;         // within the current chunk
+  std::size_t usedBefore;     // bytes used in the chunks before the current one
+  std::size_t liveBuffers;
+  std::size_t allocationCount;
+  std::size_t deallocationCount;
+  std::size_t chunkAllocations; // from the upstream pool, the misses of the statistics
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,577 @@
+#include <uenf/ImageCodec.h>
+
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <cstring>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+namespace ImageCodec
+{
+
+
+namespace
+{
+
+  unsigned char const magic[4] = { 'U', 'E', 'I', 'C' };
+
+  enum { version = 1, bandTargetBytes = 128 << 10 };
+
+  /* the operations, as in QOI: the top two bits of the first byte select index, difference, luma (larger
+     difference) or run, except for the two literal tags in the run range. 0xfe holds the first three channels (at
+     most) and keeps the fourth one, 0xff holds all.
+  */
+  enum Tag { tagIndex = 0x00, tagDiff = 0x40, tagLuma = 0x80, tagRun = 0xc0, tagLiteral = 0xfe, tagLiteralAll = 0xff };
+
+  enum { maxRun = 62 };
+
+  boost::uint32_t const maxBandBytes = std::numeric_limits<boost::uint32_t>::max();
+
+
+  void put32(unsigned char * p, boost::uint32_t v)
+  {
+    p[0] = (unsigned char)(v);
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+  }
+
+  boost::uint32_t get32(unsigned char const * p)
+  {
+    return boost::uint32_t(p[0]) | boost::uint32_t(p[1]) << 8 | boost::uint32_t(p[2]) << 16 | boost::uint32_t(p[3]) << 24;
+  }
+
+
+  void corrupt(std::string const & what)
+  {
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::parse, "image stream (" + what + ")"));
+  }
+
+
+  // every pixel codes to at most a tag plus all channels
+  std::size_t worstRowBytes(int width, int channels)
+  {
+    return std::size_t(width) * std::size_t(channels + 1);
+  }
+
+
+  //! resolves rowsPerBand zero, clamps to the height and checks that a band cannot exceed 4 GiB
+  int bandRowsOf(int width, int height, int channels, int rowsPerBand, int parameterNr)
+  {
+    if(channels < 1 or channels > 4)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(0));
+    std::size_t const worstRow = std::max<std::size_t>(worstRowBytes(width, channels), 1);
+    if(worstRow > maxBandBytes or rowsPerBand < 0)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(rowsPerBand < 0 ? parameterNr : 0));
+    int const maxRows = int(std::min<std::size_t>(maxBandBytes / worstRow, std::numeric_limits<int>::max()));
+    if(not rowsPerBand)
+      rowsPerBand = std::min(maxRows, std::max(1, int(bandTargetBytes / std::max(1, width * channels))));
+    else if(rowsPerBand > maxRows)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(parameterNr));
+    return std::min(rowsPerBand, std::max(height, 1));
+  }
+
+
+  int bandCountOf(int height, int bandRows)
+  {
+    return (height + bandRows - 1) / bandRows;
+  }
+
+
+  std::size_t headerBytesOf(int bandCount)
+  {
+    return fixedHeaderBytes + 4 * std::size_t(bandCount);
+  }
+
+
+
+  // pixels are handled as the channels packed into the low bytes of an integer, higher bytes zero
+
+  template<int C> boost::uint32_t load(unsigned char const * p);
+  template<> inline boost::uint32_t load<1>(unsigned char const * p) { return p[0]; }
+  template<> inline boost::uint32_t load<2>(unsigned char const * p) { return p[0] | boost::uint32_t(p[1]) << 8; }
+  template<> inline boost::uint32_t load<3>(unsigned char const * p)
+  {
+    return p[0] | boost::uint32_t(p[1]) << 8 | boost::uint32_t(p[2]) << 16;
+  }
+  template<> inline boost::uint32_t load<4>(unsigned char const * p) { return get32(p); }
+
+  template<int C> inline void store(unsigned char * p, boost::uint32_t px)
+  {
+    for(int c = 0; c < C; ++c)
+      p[c] = (unsigned char)(px >> 8 * c);
+  }
+
+
+  inline unsigned int hashOf(boost::uint32_t px)
+  {
+    return (px * 2654435761u) >> 26;
+  }
+
+
+  //! difference of channel c, wrapped to [-128, 127]
+  inline int delta(boost::uint32_t px, boost::uint32_t prev, int c)
+  {
+    return int(((px >> 8 * c) - (prev >> 8 * c) + 128) & 0xff) - 128;
+  }
+
+  inline unsigned char channelOf(boost::uint32_t px, int c)
+  {
+    return (unsigned char)(px >> 8 * c);
+  }
+
+
+
+  /* writes a pixel which is not a run, as index if it is in the index, else as difference to the previous one
+     or literally; this is where the channel counts differ: one channel has a single large difference, two a
+     small one for both and a larger one for the first, three and four channels are coded like QOI (differences
+     only if the fourth channel did not change). With three and four channels the choice between the codings
+     depends on the noise in the image and is hardly predictable, so all bytes of the literal are written and the
+     shorter codings selected without branches (about a third faster on noisy frames), the room for the worst
+     case of each pixel leaves space for that.
+  */
+  template<int C> inline unsigned char * putPixel(unsigned char * out, boost::uint32_t px, boost::uint32_t prev,
+                                                  bool indexed, unsigned int h)
+  {
+    int const dr = delta(px, prev, 0);
+    int const dg = delta(px, prev, 1);
+    int const db = delta(px, prev, 2);
+    bool const sameFourth = C < 4 or channelOf(px, 3) == channelOf(prev, 3);
+    bool const diff = sameFourth and (unsigned(dr + 2) | unsigned(dg + 2) | unsigned(db + 2)) < 4;
+    bool const luma = sameFourth and unsigned(dg + 32) < 64 and (unsigned(dr - dg + 8) | unsigned(db - dg + 8)) < 16;
+    unsigned int b0 = sameFourth ? tagLiteral : tagLiteralAll;
+    unsigned int b1 = channelOf(px, 0);
+    b0 = luma ? tagLuma | (dg + 32) : b0;
+    b1 = luma ? (dr - dg + 8) << 4 | (db - dg + 8) : b1;
+    b0 = diff ? tagDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2) : b0;
+    b0 = indexed ? tagIndex | h : b0;
+    out[0] = (unsigned char)(b0);
+    out[1] = (unsigned char)(b1);
+    out[2] = channelOf(px, 1);
+    out[3] = channelOf(px, 2);
+    if(C == 4)
+      out[4] = channelOf(px, 3);
+    return out + (indexed or diff ? 1 : luma ? 2 : sameFourth ? 4 : 5);
+  }
+
+  // with one or two channels the choice is mostly the difference, branches are faster there
+
+  template<> inline unsigned char * putPixel<1>(unsigned char * out, boost::uint32_t px, boost::uint32_t prev,
+                                                bool indexed, unsigned int h)
+  {
+    int const d = delta(px, prev, 0);
+    if(indexed or unsigned(d + 32) < 64)
+    {
+      *out = (unsigned char)(indexed ? tagIndex | h : tagDiff | (d + 32));
+      return out + 1;
+    }
+    out[0] = tagLiteral;
+    out[1] = channelOf(px, 0);
+    return out + 2;
+  }
+
+  template<> inline unsigned char * putPixel<2>(unsigned char * out, boost::uint32_t px, boost::uint32_t prev,
+                                                bool indexed, unsigned int h)
+  {
+    int const d0 = delta(px, prev, 0);
+    int const d1 = delta(px, prev, 1);
+    if(indexed)
+    {
+      *out = (unsigned char)(tagIndex | h);
+      return out + 1;
+    }
+    if((unsigned(d0 + 4) | unsigned(d1 + 4)) < 8)
+    {
+      *out = (unsigned char)(tagDiff | (d0 + 4) << 3 | (d1 + 4));
+      return out + 1;
+    }
+    if(unsigned(d0 + 32) < 64)
+    {
+      out[0] = (unsigned char)(tagLuma | (d0 + 32));
+      out[1] = (unsigned char)(d1);
+      return out + 2;
+    }
+    out[0] = tagLiteral;
+    store<2>(out + 1, px);
+    return out + 3;
+  }
+
+
+
+  //! the counterpart of putPixel() for tagDiff
+  template<int C> inline boost::uint32_t applyDiff(boost::uint32_t prev, unsigned int b)
+  {
+    boost::uint32_t const r = ( prev        + (b >> 4 & 3) - 2) & 0xff;
+    boost::uint32_t const g = ((prev >> 8)  + (b >> 2 & 3) - 2) & 0xff;
+    boost::uint32_t const l = ((prev >> 16) + (b      & 3) - 2) & 0xff;
+    return (prev & 0xff000000u) | r | g << 8 | l << 16;
+  }
+
+  template<> inline boost::uint32_t applyDiff<1>(boost::uint32_t prev, unsigned int b)
+  {
+    return (prev + (b & 0x3f) - 32) & 0xff;
+  }
+
+  template<> inline boost::uint32_t applyDiff<2>(boost::uint32_t prev, unsigned int b)
+  {
+    return ((prev + (b >> 3 & 7) - 4) & 0xff) | (((prev >> 8) + (b & 7) - 4) << 8 & 0xff00);
+  }
+
+
+  //! the counterpart of putPixel() for tagLuma, b2 is the second byte
+  template<int C> inline boost::uint32_t applyLuma(boost::uint32_t prev, unsigned int b, unsigned int b2)
+  {
+    int const dg = int(b & 0x3f) - 32;
+    boost::uint32_t const r = ( prev        + dg + int(b2 >> 4) - 8) & 0xff;
+    boost::uint32_t const g = ((prev >> 8)  + dg)                    & 0xff;
+    boost::uint32_t const l = ((prev >> 16) + dg + int(b2 & 15) - 8) & 0xff;
+    return (prev & 0xff000000u) | r | g << 8 | l << 16;
+  }
+
+  template<> inline boost::uint32_t applyLuma<2>(boost::uint32_t prev, unsigned int b, unsigned int b2)
+  {
+    return ((prev + (b & 0x3f) - 32) & 0xff) | (((prev >> 8) + b2) << 8 & 0xff00);
+  }
+
+
+
+  //! encodes the rows [firstRow, endRow) to out, which has room for worstRowBytes() per row, returns the size
+  template<int C> std::size_t encodeRows(ImageU8 const & image, int firstRow, int endRow, unsigned char * out)
+  {
+    unsigned char * const begin = out;
+    boost::uint32_t index[64] = {};
+    boost::uint32_t prev = 0;
+    int run = 0;
+    int const width = image.width();
+    for(int y = firstRow; y < endRow; ++y)
+    {
+      unsigned char const * src = image.row(y);
+      for(int x = 0; x < width; ++x, src += C)
+      {
+        boost::uint32_t const px = load<C>(src);
+        if(px == prev)
+        {
+          if(++run == maxRun)
+          {
+            *out++ = (unsigned char)(tagRun | (run - 1));
+            run = 0;
+          }
+          continue;
+        }
+        if(run)
+        {
+          *out++ = (unsigned char)(tagRun | (run - 1));
+          run = 0;
+        }
+        unsigned int const h = hashOf(px);
+        bool const indexed = index[h] == px;
+        index[h] = px;
+        out = putPixel<C>(out, px, prev, indexed, h);
+        prev = px;
+      }
+    }
+    if(run)
+      *out++ = (unsigned char)(tagRun | (run - 1));
+    return std::size_t(out - begin);
+  }
+
+
+  std::size_t encodeRows(ImageU8 const & image, int firstRow, int endRow, unsigned char * out)
+  {
+    switch(image.channels())
+    {
+      case 1:  return encodeRows<1>(image, firstRow, endRow, out);
+      case 2:  return encodeRows<2>(image, firstRow, endRow, out);
+      case 3:  return encodeRows<3>(image, firstRow, endRow, out);
+      default: return encodeRows<4>(image, firstRow, endRow, out);
+    }
+  }
+
+
+
+  //! decodes the size bytes at in into the rows [firstRow, endRow), every read is checked against the end
+  template<int C> void decodeRows(unsigned char const * in, std::size_t size, ImageU8 & image, int firstRow,
+                                  int endRow)
+  {
+    unsigned char const * const end = in + size;
+    boost::uint32_t index[64] = {};
+    boost::uint32_t px = 0;
+    int run = 0;
+    int const width = image.width();
+    for(int y = firstRow; y < endRow; ++y)
+    {
+      unsigned char * dst = image.row(y);
+      for(int x = 0; x < width; ++x, dst += C)
+      {
+        if(run)
+        {
+          --run;
+          store<C>(dst, px);
+          continue;
+        }
+        if(in == end)
+          corrupt("band truncated");
+        unsigned int const b = *in++;
+        if(b >= tagLiteral)
+        {
+          int const n = b == tagLiteralAll ? C : std::min(C, 3);
+          if(end - in < n)
+            corrupt("band truncated");
+          for(int c = 0; c < n; ++c)
+            px = (px & ~(0xffu << 8 * c)) | boost::uint32_t(in[c]) << 8 * c;
+          in += n;
+        }
+        else
+        {
+          switch(b & 0xc0)
+          {
+            case tagIndex:
+              px = index[b];
+              store<C>(dst, px);
+              continue;
+            case tagDiff:
+              px = applyDiff<C>(px, b);
+              break;
+            case tagLuma:
+              if(C == 1)
+                corrupt("invalid operation");
+              if(in == end)
+                corrupt("band truncated");
+              px = applyLuma<C>(px, b, *in++);
+              break;
+            default: // tagRun
+              run = b & 0x3f;
+              store<C>(dst, px);
+              continue;
+          }
+        }
+        index[hashOf(px)] = px;
+        store<C>(dst, px);
+      }
+    }
+    if(run)
+      corrupt("run beyond the band");
+    if(in not_eq end)
+      corrupt("data after the last pixel of a band");
+  }
+
+}  // end of anonymous namespace
+
+
+
+std::size_t maxEncodedBytes(int width, int height, int channels, int rowsPerBand)
+{
+  if(width < 0 or height < 0)
+    BOOST_THROW_EXCEPTION(ExceptionParameter(width < 0 ? 0 : 1));
+  int const bandRows = bandRowsOf(width, height, channels, rowsPerBand, 3);
+  return headerBytesOf(bandCountOf(height, bandRows)) + worstRowBytes(width, channels) * std::size_t(height);
+}
+
+
+
+std::size_t encode(ImageU8 const & image, unsigned char * out, std::size_t capacity, int rowsPerBand,
+                   ThreadPool & pool)
+{
+  int const width = image.width();
+  int const height = image.height();
+  int const channels = image.channels();
+  int const bandRows = bandRowsOf(width, height, channels, rowsPerBand, 3);
+  int const bandCount = bandCountOf(height, bandRows);
+  std::size_t const headerBytes = headerBytesOf(bandCount);
+  std::size_t const worstRow = worstRowBytes(width, channels);
+  if(capacity < headerBytes + worstRow * std::size_t(height))
+    BOOST_THROW_EXCEPTION(ExceptionParameter(2));
+
+  std::memcpy(out, magic, 4);
+  out[4] = version;
+  out[5] = (unsigned char)(channels);
+  out[6] = out[7] = 0;
+  put32(out + 8, boost::uint32_t(width));
+  put32(out + 12, boost::uint32_t(height));
+  put32(out + 16, boost::uint32_t(bandRows));
+
+  // each band is encoded into the room for its worst case, the sizes go into the header for now
+  pool.parallelFor(std::size_t(bandCount), 1, [&](std::size_t begin, std::size_t end)
+  {
+    for(std::size_t band = begin; band < end; ++band)
+    {
+      int const firstRow = int(band) * bandRows;
+      int const endRow = firstRow + std::min(bandRows, height - firstRow);
+      std::size_t const size = encodeRows(image, firstRow, endRow, out + headerBytes + worstRow * firstRow);
+      put32(out + fixedHeaderBytes + 4 * band, boost::uint32_t(size));
+    }
+  });
+
+  // then the bands are moved together, each one only moves towards the front and behind the one before
+  std::size_t size = headerBytes;
+  for(int band = 0; band < bandCount; ++band)
+  {
+    std::size_t const bandBytes = get32(out + fixedHeaderBytes + 4 * band);
+    std::memmove(out + size, out + headerBytes + worstRow * std::size_t(band) * bandRows, bandBytes);
+    size += bandBytes;
+  }
+  return size;
+}
+
+
+
+void encode(ImageU8 const & image, std::vector<unsigned char> & out, int rowsPerBand, ThreadPool & pool)
+{
+  out.resize(maxEncodedBytes(image.width(), image.height(), image.channels(), rowsPerBand));
+  out.resize(encode(image, &out[0], out.size(), rowsPerBand, pool));
+}
+
+
+
+void decode(unsigned char const * data, std::size_t size, ImageU8 & image, ThreadPool & pool)
+{
+  if(size < fixedHeaderBytes or size < Decoder::headerBytes(data, size))
+    corrupt("header truncated");
+  Decoder const decoder(data, size);
+  if(size < decoder.streamBytes())
+    corrupt("stream truncated");
+  decoder.prepare(image);
+  pool.parallelFor(std::size_t(decoder.bandCount()), 1, [&](std::size_t begin, std::size_t end)
+  {
+    for(std::size_t band = begin; band < end; ++band)
+      decoder.decodeBand(int(band), data + decoder.bandOffset(int(band)), image);
+  });
+}
+
+
+
+void writeFile(std::string const & fileName, ImageU8 const & image, int rowsPerBand)
+{
+  std::vector<unsigned char> stream;
+  encode(image, stream, rowsPerBand);
+  std::ofstream file(fileName.c_str(), std::ios::binary);
+  if(not file)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::open, fileName));
+  file.write(reinterpret_cast<char const *>(&stream[0]), std::streamsize(stream.size()));
+  file.flush();
+  if(not file)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::write, fileName));
+}
+
+
+
+void readFile(std::string const & fileName, ImageU8 & image)
+{
+  std::ifstream file(fileName.c_str(), std::ios::binary);
+  if(not file)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::open, fileName));
+  file.seekg(0, std::ios::end);
+  std::streamoff const size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  if(size < 0 or not file)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::read, fileName));
+  std::vector<unsigned char> stream(std::max<std::size_t>(std::size_t(size), 1));
+  if(not file.read(reinterpret_cast<char *>(&stream[0]), size))
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::read, fileName));
+  try
+  {
+    decode(&stream[0], std::size_t(size), image);
+  }
+  catch(ExceptionIO const & e)
+  {
+    BOOST_THROW_EXCEPTION(ExceptionIO(e.spec, fileName + ": " + e.name));
+  }
+}
+
+
+
+
+std::size_t Decoder::headerBytes(unsigned char const * data, std::size_t size)
+{
+  if(size < fixedHeaderBytes)
+    BOOST_THROW_EXCEPTION(ExceptionParameter(1));
+  if(std::memcmp(data, magic, 4) not_eq 0)
+    corrupt("not an encoded image");
+  if(data[4] not_eq version)
+    corrupt("unknown version");
+  boost::uint32_t const height = get32(data + 12);
+  boost::uint32_t const bandRows = get32(data + 16);
+  if(height > boost::uint32_t(std::numeric_limits<int>::max()) or (height and not bandRows))
+    corrupt("invalid size");
+  return headerBytesOf(height ? int((height - 1) / bandRows + 1) : 0);
+}
+
+
+
+Decoder::Decoder(unsigned char const * data, std::size_t size)
+{
+  std::size_t const headerSize = headerBytes(data, size);
+  if(size < headerSize)
+    BOOST_THROW_EXCEPTION(ExceptionParameter(1));
+  boost::uint32_t const width = get32(data + 8);
+  // the stride of an Image (in elements, padded) is an int
+  if(data[5] < 1 or data[5] > 4 or
+     std::size_t(width) * data[5] > std::size_t(std::numeric_limits<int>::max() - ImageU8::rowAlignment))
+    corrupt("invalid size");
+  imageWidth = int(width);
+  imageHeight = int(get32(data + 12));
+  imageChannels = data[5];
+  bandRows = int(std::min<boost::uint32_t>(get32(data + 16), boost::uint32_t(std::max(imageHeight, 1))));
+
+  /* no band can be larger than its worst case, which also keeps the offsets from overflowing, nor smaller than
+     runs of all its pixels, so decode() does not allocate an image of a size made up by a corrupt header before
+     it found the stream is not that long
+  */
+  std::size_t const worstRow = worstRowBytes(imageWidth, imageChannels);
+  int const bandCount = int((headerSize - fixedHeaderBytes) / 4);
+  offsets.resize(std::size_t(bandCount) + 1);
+  offsets[0] = headerSize;
+  for(int band = 0; band < bandCount; ++band)
+  {
+    std::size_t const bandBytes = get32(data + fixedHeaderBytes + 4 * band);
+    std::size_t const pixels = std::size_t(imageWidth) * std::size_t(rows(band));
+    if(bandBytes > worstRow * std::size_t(rows(band)) or bandBytes < (pixels + maxRun - 1) / maxRun)
+      corrupt("invalid band size");
+    offsets[band + 1] = offsets[band] + bandBytes;
+  }
+}
+
+
+
+int Decoder::rows(int band) const
+{
+  return std::min(bandRows, imageHeight - band * bandRows);
+}
+
+
+
+void Decoder::prepare(ImageU8 & image) const
+{
+  image.resize(imageWidth, imageHeight, imageChannels);
+}
+
+
+
+void Decoder::decodeBand(int band, unsigned char const * data, ImageU8 & image) const
+{
+  if(band < 0 or band >= bandCount())
+    BOOST_THROW_EXCEPTION(ExceptionParameter(0));
+  if(image.width() not_eq imageWidth or image.height() not_eq imageHeight or image.channels() not_eq imageChannels)
+    BOOST_THROW_EXCEPTION(ExceptionParameter(2));
+  int const firstRow = band * bandRows;
+  int const endRow = firstRow + rows(band);
+  switch(imageChannels)
+  {
+    case 1:  decodeRows<1>(data, bandBytes(band), image, firstRow, endRow); break;
+    case 2:  decodeRows<2>(data, bandBytes(band), image, firstRow, endRow); break;
+    case 3:  decodeRows<3>(data, bandBytes(band), image, firstRow, endRow); break;
+    default: decodeRows<4>(data, bandBytes(band), image, firstRow, endRow); break;
+  }
+}
+
+
+
+}  // end of namespace ImageCodec
+
+}  // end of namespace uenf
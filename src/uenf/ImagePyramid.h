@@ -0,0 +1,96 @@
+#ifndef UENF_IMAGEPYRAMID_H
+#define UENF_IMAGEPYRAMID_H
+
+
+#include <uenf/Image.h>
+#include <uenf/Resample.h>
+
+#include <vector>
+#include <algorithm>
+#include <ciso646>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  Gaussian image pyramid: level 0 is the input image itself (not copied, so it has to stay unchanged as long as
+  the levels are used), each following level is the previous one low-pass filtered with a gaussian and halved in
+  size.
+
+  All levels, their resamplers (holding the weight tables) and the intermediate buffers are kept between calls to
+  build(), so building the pyramid for a stream of equally sized frames does not allocate anything after the first
+  frame. Example:
+
+    GaussianPyramid<unsigned char> pyramid(4);
+    while(grabFrame(frame))
+    {
+      pyramid.build(frame);
+      process(pyramid.level(3));
+    }
+*/
+template<typename T> class GaussianPyramid
+{
+public:
+  //! the pyramid will stop early, if a level would become smaller than minSize in one dimension
+  explicit GaussianPyramid(int maxLevelsArg, int minSizeArg = 8):maxLevels(std::max(1, maxLevelsArg)),
+    minSize(std::max(1, minSizeArg)), levelCount(0), base(0) {}
+
+  void build(Image<T> const & baseArg)
+  {
+    if(baseArg.empty())
+      BOOST_THROW_EXCEPTION(ExceptionParameter(0));
+
+    // level i > 0 is levels[i - 1], resampled by resamplers[i - 1]
+    if(levels.size() not_eq std::size_t(maxLevels - 1))
+    {
+      levels.resize(maxLevels - 1);
+      resamplers.assign(maxLevels - 1, Resample::Resampler(Resample::gaussian));
+    }
+
+    base = &baseArg;
+    levelCount = 1;
+    while(levelCount < maxLevels)
+    {
+      Image<T> const & previous = level(levelCount - 1);
+      int const w = previous.width() / 2;
+      int const h = previous.height() / 2;
+      if(w < minSize or h < minSize)
+        break;
+      resamplers[levelCount - 1].resample(previous, levels[levelCount - 1], w, h);
+      ++levelCount;
+    }
+  }
+
+  //! number of levels of the last build (may be less than maxLevels for small images)
+  int size() const { return levelCount; }
+
+  Image<T> const & level(int i) const
+  {
+    if(i < 0 or i >= levelCount)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(0));
+    return i ? levels[i - 1] : *base;
+  }
+
+private:
+  int const maxLevels;
+  int const minSize;
+  int levelCount;
+  Image<T> const * base; // level 0
+  std::vector<Image<T> > levels;
+  std::vector<Resample::Resampler> resamplers;
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <uenf/Log.h>
 #include <uenf/Exceptions.h>
+#include <uenf/Trace.h>
+#include <uenf/Metrics.h>
 
 #include <iostream>
 #include <fstream>
@@ -16,6 +18,17 @@ namespace Log
 {
 
 
+namespace
+{
+  //! how long callLoggers() keeps the logger list locked (i.e. how long all loggers take for one message)
+  Metrics::Histogram & lockHoldTime()
+  {
+    static Metrics::Histogram & histogram = Metrics::Registry::global().histogram("uenf.log.dispatch_lock_hold_ns");
+    return histogram;
+  }
+}
+
+
 Logger::Logger():severityMask(0xffffffff), minSeverity(minSeverityEnum)
 {
   /* we dont do "LogDispatcher::addLogger(this);" here because:
@@ -175,7 +188,9 @@ void LogDispatcher::setMinSeverityOnAllListeners (Severity minSev)
 
 void LogDispatcher::callLoggers(std::string const & message, Severity severity)
 {
+  UENF_TRACE_ZONE("LogDispatcher::callLoggers");
   boost::unique_lock<boost::mutex> guard(*(getLoggerListMutex()));
+  Metrics::ScopedTimer holdTimer(lockHoldTime()); // destroyed before the guard, so only the hold time counts
   std::list<Logger *>::iterator it = getLoggerList()->begin();
   for(; it not_eq getLoggerList()->end(); ++it)
   {
@@ -186,7 +201,9 @@ void LogDispatcher::callLoggers(std::string const & message, Severity severity)
 
 void LogDispatcher::callLoggers(std::string const & message, unsigned int userCode)
 {
+  UENF_TRACE_ZONE("LogDispatcher::callLoggers");
   boost::unique_lock<boost::mutex> guard(*(getLoggerListMutex()));
+  Metrics::ScopedTimer holdTimer(lockHoldTime()); // destroyed before the guard, so only the hold time counts
   std::list<Logger *>::iterator it = getLoggerList()->begin();
   for(; it not_eq getLoggerList()->end(); ++it)
   {
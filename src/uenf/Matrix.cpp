@@ -0,0 +1,289 @@
+
+
+
+#include <uenf/Matrix.h>
+#include <uenf/ThreadPool.h>
+#include <uenf/Exceptions.h>
+
+#include <algorithm>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+
+namespace
+{
+
+  // work per parallel chunk, small enough to balance, large enough to amortize the scheduling
+  std::size_t const chunkSize = 1 << 14;
+
+  // the kernels work on blocks of this many elements with temporaries on the stack, which keeps them in L1,
+  // avoids heap allocation and makes input and output aliasing harmless
+  int const blockSize = 256;
+  typedef Eigen::Array<float, Eigen::Dynamic, 1, 0, blockSize, 1> Block;
+
+
+  //! calls f(begin, n) for blocks of at most blockSize elements, chunks of blocks in parallel
+  template<typename F> void forEachBlock(std::size_t count, F const & f)
+  {
+    ThreadPool::global().parallelFor(count, chunkSize, [&f](std::size_t begin, std::size_t end)
+    {
+      for(std::size_t b = begin; b < end; b += blockSize)
+        f(Eigen::Index(b), Eigen::Index(std::min<std::size_t>(blockSize, end - b)));
+    });
+  }
+
+
+  void checkSizes(std::size_t a, std::size_t b)
+  {
+    if(a not_eq b)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(1));
+  }
+
+}  // end of anonymous namespace
+
+
+
+
+
+
+void Vector2fSoA::fromAoS(std::vector<Vector2f> const & aos)
+{
+  resize(aos.size());
+  // Vector2f has no padding, so the AoS data is a 2 x n matrix we can transpose row-wise
+  if(aos.empty())
+    return;
+  Eigen::Map<Eigen::Matrix<float, 2, Eigen::Dynamic> const> m(aos[0].data(), 2, aos.size());
+  x = m.row(0).transpose().array();
+  y = m.row(1).transpose().array();
+}
+
+
+
+void Vector2fSoA::toAoS(std::vector<Vector2f> & aos) const
+{
+  aos.resize(size());
+  if(aos.empty())
+    return;
+  Eigen::Map<Eigen::Matrix<float, 2, Eigen::Dynamic> > m(aos[0].data(), 2, aos.size());
+  m.row(0) = x.matrix().transpose();
+  m.row(1) = y.matrix().transpose();
+}
+
+
+
+void Vector3fSoA::fromAoS(std::vector<Vector3f> const & aos)
+{
+  resize(aos.size());
+  if(aos.empty())
+    return;
+  Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic> const> m(aos[0].data(), 3, aos.size());
+  x = m.row(0).transpose().array();
+  y = m.row(1).transpose().array();
+  z = m.row(2).transpose().array();
+}
+
+
+
+void Vector3fSoA::toAoS(std::vector<Vector3f> & aos) const
+{
+  aos.resize(size());
+  if(aos.empty())
+    return;
+  Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic> > m(aos[0].data(), 3, aos.size());
+  m.row(0) = x.matrix().transpose();
+  m.row(1) = y.matrix().transpose();
+  m.row(2) = z.matrix().transpose();
+}
+
+
+
+
+
+
+
+
+
+void transform(Vector2fSoA const & in, Matrix2f const & m, Vector2fSoA & out)
+{
+  out.resize(in.size());
+  forEachBlock(in.size(), [&](Eigen::Index b, Eigen::Index n)
+  {
+    Block const x = in.x.segment(b, n), y = in.y.segment(b, n);
+    out.x.segment(b, n) = m(0, 0) * x + m(0, 1) * y;
+    out.y.segment(b, n) = m(1, 0) * x + m(1, 1) * y;
+  });
+}
+
+
+
+void transform(Vector3fSoA const & in, Matrix3f const & m, Vector3fSoA & out)
+{
+  out.resize(in.size());
+  forEachBlock(in.size(), [&](Eigen::Index b, Eigen::Index n)
+  {
+    Block const x = in.x.segment(b, n), y = in.y.segment(b, n), z = in.z.segment(b, n);
+    out.x.segment(b, n) = m(0, 0) * x + m(0, 1) * y + m(0, 2) * z;
+    out.y.segment(b, n) = m(1, 0) * x + m(1, 1) * y + m(1, 2) * z;
+    out.z.segment(b, n) = m(2, 0) * x + m(2, 1) * y + m(2, 2) * z;
+  });
+}
+
+
+
+void transformPoints(Vector2fSoA const & in, Matrix3f const & m, Vector2fSoA & out)
+{
+  out.resize(in.size());
+  bool const affine = m(2, 0) == 0.0f and m(2, 1) == 0.0f and m(2, 2) == 1.0f;
+  forEachBlock(in.size(), [&](Eigen::Index b, Eigen::Index n)
+  {
+    Block const x = in.x.segment(b, n), y = in.y.segment(b, n);
+    if(affine)
+    {
+      out.x.segment(b, n) = m(0, 0) * x + m(0, 1) * y + m(0, 2);
+      out.y.segment(b, n) = m(1, 0) * x + m(1, 1) * y + m(1, 2);
+    }
+    else
+    {
+      Block const invW = (m(2, 0) * x + m(2, 1) * y + m(2, 2)).inverse();
+      out.x.segment(b, n) = (m(0, 0) * x + m(0, 1) * y + m(0, 2)) * invW;
+      out.y.segment(b, n) = (m(1, 0) * x + m(1, 1) * y + m(1, 2)) * invW;
+    }
+  });
+}
+
+
+
+void transformPoints(Vector3fSoA const & in, Matrix4f const & m, Vector3fSoA & out)
+{
+  out.resize(in.size());
+  bool const affine = m(3, 0) == 0.0f and m(3, 1) == 0.0f and m(3, 2) == 0.0f and m(3, 3) == 1.0f;
+  forEachBlock(in.size(), [&](Eigen::Index b, Eigen::Index n)
+  {
+    Block const x = in.x.segment(b, n), y = in.y.segment(b, n), z = in.z.segment(b, n);
+    if(affine)
+    {
+      out.x.segment(b, n) = m(0, 0) * x + m(0, 1) * y + m(0, 2) * z + m(0, 3);
+      out.y.segment(b, n) = m(1, 0) * x + m(1, 1) * y + m(1, 2) * z + m(1, 3);
+      out.z.segment(b, n) = m(2, 0) * x + m(2, 1) * y + m(2, 2) * z + m(2, 3);
+    }
+    else
+    {
+      Block const invW = (m(3, 0) * x + m(3, 1) * y + m(3, 2) * z + m(3, 3)).inverse();
+      out.x.segment(b, n) = (m(0, 0) * x + m(0, 1) * y + m(0, 2) * z + m(0, 3)) * invW;
+      out.y.segment(b, n) = (m(1, 0) * x + m(1, 1) * y + m(1, 2) * z + m(1, 3)) * invW;
+      out.z.segment(b, n) = (m(2, 0) * x + m(2, 1) * y + m(2, 2) * z + m(2, 3)) * invW;
+    }
+  });
+}
+
+
+
+void dot(Vector2fSoA const & a, Vector2fSoA const & b, Eigen::ArrayXf & out)
+{
+  checkSizes(a.size(), b.size());
+  out.resize(a.size());
+  forEachBlock(a.size(), [&](Eigen::Index s, Eigen::Index n)
+  {
+    out.segment(s, n) = a.x.segment(s, n) * b.x.segment(s, n) + a.y.segment(s, n) * b.y.segment(s, n);
+  });
+}
+
+
+
+void dot(Vector3fSoA const & a, Vector3fSoA const & b, Eigen::ArrayXf & out)
+{
+  checkSizes(a.size(), b.size());
+  out.resize(a.size());
+  forEachBlock(a.size(), [&](Eigen::Index s, Eigen::Index n)
+  {
+    out.segment(s, n) = a.x.segment(s, n) * b.x.segment(s, n) + a.y.segment(s, n) * b.y.segment(s, n)
+                      + a.z.segment(s, n) * b.z.segment(s, n);
+  });
+}
+
+
+
+void cross(Vector3fSoA const & a, Vector3fSoA const & b, Vector3fSoA & out)
+{
+  checkSizes(a.size(), b.size());
+  out.resize(a.size());
+  forEachBlock(a.size(), [&](Eigen::Index s, Eigen::Index n)
+  {
+    Block const ax = a.x.segment(s, n), ay = a.y.segment(s, n), az = a.z.segment(s, n);
+    Block const bx = b.x.segment(s, n), by = b.y.segment(s, n), bz = b.z.segment(s, n);
+    out.x.segment(s, n) = ay * bz - az * by;
+    out.y.segment(s, n) = az * bx - ax * bz;
+    out.z.segment(s, n) = ax * by - ay * bx;
+  });
+}
+
+
+
+void normalize(Vector2fSoA & v)
+{
+  forEachBlock(v.size(), [&](Eigen::Index s, Eigen::Index n)
+  {
+    Block const squared = v.x.segment(s, n).square() + v.y.segment(s, n).square();
+    Block const scale = (squared > 0.0f).select(squared.rsqrt(), 1.0f);
+    v.x.segment(s, n) *= scale;
+    v.y.segment(s, n) *= scale;
+  });
+}
+
+
+
+void normalize(Vector3fSoA & v)
+{
+  forEachBlock(v.size(), [&](Eigen::Index s, Eigen::Index n)
+  {
+    Block const squared = v.x.segment(s, n).square() + v.y.segment(s, n).square() + v.z.segment(s, n).square();
+    Block const scale = (squared > 0.0f).select(squared.rsqrt(), 1.0f);
+    v.x.segment(s, n) *= scale;
+    v.y.segment(s, n) *= scale;
+    v.z.segment(s, n) *= scale;
+  });
+}
+
+
+
+AlignedBox2f boundingBox(Vector2fSoA const & v)
+{
+  // one box per chunk, merged afterwards, so the chunks do not need to synchronize
+  std::vector<AlignedBox2f> boxes((v.size() + chunkSize - 1) / chunkSize);
+  ThreadPool::global().parallelFor(v.size(), chunkSize, [&](std::size_t begin, std::size_t end)
+  {
+    Eigen::Index const b = Eigen::Index(begin), n = Eigen::Index(end - begin);
+    boxes[begin / chunkSize] = AlignedBox2f(Vector2f(v.x.segment(b, n).minCoeff(), v.y.segment(b, n).minCoeff()),
+                                            Vector2f(v.x.segment(b, n).maxCoeff(), v.y.segment(b, n).maxCoeff()));
+  });
+  AlignedBox2f box;
+  for(std::size_t i = 0; i < boxes.size(); ++i)
+    box.extend(boxes[i]);
+  return box;
+}
+
+
+
+AlignedBox3f boundingBox(Vector3fSoA const & v)
+{
+  std::vector<AlignedBox3f> boxes((v.size() + chunkSize - 1) / chunkSize);
+  ThreadPool::global().parallelFor(v.size(), chunkSize, [&](std::size_t begin, std::size_t end)
+  {
+    Eigen::Index const b = Eigen::Index(begin), n = Eigen::Index(end - begin);
+    boxes[begin / chunkSize] = AlignedBox3f(
+      Vector3f(v.x.segment(b, n).minCoeff(), v.y.segment(b, n).minCoeff(), v.z.segment(b, n).minCoeff()),
+      Vector3f(v.x.segment(b, n).maxCoeff(), v.y.segment(b, n).maxCoeff(), v.z.segment(b, n).maxCoeff()));
+  });
+  AlignedBox3f box;
+  for(std::size_t i = 0; i < boxes.size(); ++i)
+    box.extend(boxes[i]);
+  return box;
+}
+
+
+
+
+} // end of namespace uenf
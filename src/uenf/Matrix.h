@@ -3,6 +3,10 @@
 
 
 #include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <vector>
+#include <cstddef>
 
 
 namespace uenf
@@ -14,6 +18,93 @@ namespace uenf
   typedef Eigen::Vector2f Vector2f;
   typedef Eigen::Vector3f Vector3f;
 
+  typedef Eigen::Matrix2f Matrix2f;
+  typedef Eigen::Matrix3f Matrix3f;
+  typedef Eigen::Matrix4f Matrix4f;
+
+  typedef Eigen::AlignedBox<float, 2> AlignedBox2f;
+  typedef Eigen::AlignedBox<float, 3> AlignedBox3f;
+
+
+
+
+  /*!
+    Structure-of-arrays containers for many 2D/3D vectors: each component lives in its own contiguous, aligned
+    Eigen array, so the kernels below use all SIMD lanes (a std::vector<Vector3f> wastes a quarter of them and
+    needs shuffles on every access). The kernels process large containers in parallel chunks on
+    ThreadPool::global(), input and output may be the same container.
+
+      Vector3fSoA points(meshVertices);          // from std::vector<Vector3f>
+      transformPoints(points, modelView, points);
+      AlignedBox3f box = boundingBox(points);
+      points.toAoS(meshVertices);
+  */
+  class Vector2fSoA
+  {
+  public:
+    Vector2fSoA() {}
+    explicit Vector2fSoA(std::size_t n):x(n), y(n) {}
+    explicit Vector2fSoA(std::vector<Vector2f> const & aos) { fromAoS(aos); }
+
+    std::size_t size() const { return std::size_t(x.size()); }
+    void resize(std::size_t n) { x.resize(n); y.resize(n); }
+
+    Vector2f get(std::size_t i) const { return Vector2f(x[i], y[i]); }
+    void set(std::size_t i, Vector2f const & v) { x[i] = v.x(); y[i] = v.y(); }
+
+    void fromAoS(std::vector<Vector2f> const & aos);
+    void toAoS(std::vector<Vector2f> & aos) const;
+
+    Eigen::ArrayXf x, y;
+  };
+
+
+
+  class Vector3fSoA
+  {
+  public:
+    Vector3fSoA() {}
+    explicit Vector3fSoA(std::size_t n):x(n), y(n), z(n) {}
+    explicit Vector3fSoA(std::vector<Vector3f> const & aos) { fromAoS(aos); }
+
+    std::size_t size() const { return std::size_t(x.size()); }
+    void resize(std::size_t n) { x.resize(n); y.resize(n); z.resize(n); }
+
+    Vector3f get(std::size_t i) const { return Vector3f(x[i], y[i], z[i]); }
+    void set(std::size_t i, Vector3f const & v) { x[i] = v.x(); y[i] = v.y(); z[i] = v.z(); }
+
+    void fromAoS(std::vector<Vector3f> const & aos);
+    void toAoS(std::vector<Vector3f> & aos) const;
+
+    Eigen::ArrayXf x, y, z;
+  };
+
+
+
+
+  // batched kernels, out is resized to the size of the input(s), inputs of different size throw an ExceptionParameter
+
+  //! out = m * in
+  void transform(Vector2fSoA const & in, Matrix2f const & m, Vector2fSoA & out);
+  //! out = m * in
+  void transform(Vector3fSoA const & in, Matrix3f const & m, Vector3fSoA & out);
+  //! 2D points in homogeneous coordinates (w = 1), including the perspective division
+  void transformPoints(Vector2fSoA const & in, Matrix3f const & m, Vector2fSoA & out);
+  //! 3D points in homogeneous coordinates (w = 1), including the perspective division
+  void transformPoints(Vector3fSoA const & in, Matrix4f const & m, Vector3fSoA & out);
+
+  void dot(Vector2fSoA const & a, Vector2fSoA const & b, Eigen::ArrayXf & out);
+  void dot(Vector3fSoA const & a, Vector3fSoA const & b, Eigen::ArrayXf & out);
+  void cross(Vector3fSoA const & a, Vector3fSoA const & b, Vector3fSoA & out);
+
+  //! vectors of length zero are left unchanged
+  void normalize(Vector2fSoA & v);
+  void normalize(Vector3fSoA & v);
+
+  //! an empty box for empty containers
+  AlignedBox2f boundingBox(Vector2fSoA const & v);
+  AlignedBox3f boundingBox(Vector3fSoA const & v);
+
 
 }
 
@@ -21,4 +112,3 @@ namespace uenf
 
 #endif
 
-
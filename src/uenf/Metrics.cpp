@@ -0,0 +1,292 @@
+#include <uenf/Metrics.h>
+#include <uenf/Exceptions.h>
+
+#include <boost/thread/locks.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+namespace Metrics
+{
+
+
+namespace detail
+{
+
+  namespace
+  {
+    boost::atomic<unsigned int> nextShard(0);
+    thread_local unsigned int currentShard = 0; // shard + 1, 0 means not yet assigned
+  }
+
+  unsigned int shardIndex()
+  {
+    if(not currentShard)
+      currentShard = nextShard.fetch_add(1, boost::memory_order_relaxed) % maxShards + 1;
+    return currentShard - 1;
+  }
+
+} // end of namespace detail
+
+
+
+
+boost::uint64_t Counter::value() const
+{
+  boost::uint64_t sum = 0;
+  for(int i = 0; i < maxShards; ++i)
+    sum += shards[i].value.load(boost::memory_order_relaxed);
+  return sum;
+}
+
+
+
+
+
+
+Histogram::Histogram()
+{
+  for(int s = 0; s < shardCount; ++s)
+  {
+    shards[s].sum = 0;
+    for(int b = 0; b < bucketCount; ++b)
+      shards[s].buckets[b] = 0;
+  }
+}
+
+
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+  Snapshot result;
+  for(int s = 0; s < shardCount; ++s)
+  {
+    result.sum += shards[s].sum.load(boost::memory_order_relaxed);
+    for(int b = 0; b < bucketCount; ++b)
+    {
+      boost::uint64_t const n = shards[s].buckets[b].load(boost::memory_order_relaxed);
+      result.buckets[b] += n;
+      result.count += n;
+    }
+  }
+  return result;
+}
+
+
+
+boost::uint64_t Histogram::lowerBoundOf(unsigned int bucket)
+{
+  if(bucket < unsigned(subBuckets))
+    return bucket;
+  unsigned int const exponent = bucket / subBuckets + subBucketBits - 1;
+  boost::uint64_t const sub = bucket % subBuckets;
+  return (boost::uint64_t(subBuckets) + sub) << (exponent - subBucketBits);
+}
+
+
+
+namespace
+{
+  boost::uint64_t middleOf(unsigned int bucket)
+  {
+    boost::uint64_t const lower = Histogram::lowerBoundOf(bucket);
+    if(bucket + 1 >= unsigned(Histogram::bucketCount))
+      return lower;
+    return lower + (Histogram::lowerBoundOf(bucket + 1) - lower) / 2;
+  }
+}
+
+
+
+boost::uint64_t Histogram::Snapshot::quantile(double q) const
+{
+  if(not count)
+    return 0;
+  q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+  boost::uint64_t rank = boost::uint64_t(q * double(count) + 0.5);
+  if(rank < 1)
+    rank = 1;
+  boost::uint64_t seen = 0;
+  for(unsigned int b = 0; b < buckets.size(); ++b)
+  {
+    seen += buckets[b];
+    if(seen >= rank)
+      return middleOf(b);
+  }
+  return max();
+}
+
+
+
+boost::uint64_t Histogram::Snapshot::max() const
+{
+  for(unsigned int b = buckets.size(); b > 0; --b)
+    if(buckets[b - 1])
+      return middleOf(b - 1);
+  return 0;
+}
+
+
+
+
+
+
+Registry::~Registry()
+{
+  for(std::map<std::string, Entry>::iterator it = metrics.begin(); it not_eq metrics.end(); ++it)
+  {
+    switch(it->second.type)
+    {
+      case counterType:   delete static_cast<Counter *>(it->second.metric);   break;
+      case gaugeType:     delete static_cast<Gauge *>(it->second.metric);     break;
+      case histogramType: delete static_cast<Histogram *>(it->second.metric); break;
+    }
+  }
+}
+
+
+
+Registry & Registry::global()
+{
+  // the static pointer is a wanted memory leak, metrics may still be recorded during static destruction
+  static Registry * registry = new Registry;
+  return *registry;
+}
+
+
+
+void * Registry::find(std::string const & name, Type type)
+{
+  boost::lock_guard<boost::mutex> guard(mutex);
+  std::map<std::string, Entry>::iterator it = metrics.find(name);
+  if(it not_eq metrics.end())
+  {
+    if(it->second.type not_eq type)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(1));
+    return it->second.metric;
+  }
+
+  Entry entry;
+  entry.type = type;
+  switch(type)
+  {
+    case counterType:   entry.metric = new Counter;   break;
+    case gaugeType:     entry.metric = new Gauge;     break;
+    case histogramType: entry.metric = new Histogram; break;
+  }
+  metrics[name] = entry;
+  return entry.metric;
+}
+
+
+
+Counter & Registry::counter(std::string const & name)
+{
+  return *static_cast<Counter *>(find(name, counterType));
+}
+
+
+
+Gauge & Registry::gauge(std::string const & name)
+{
+  return *static_cast<Gauge *>(find(name, gaugeType));
+}
+
+
+
+Histogram & Registry::histogram(std::string const & name)
+{
+  return *static_cast<Histogram *>(find(name, histogramType));
+}
+
+
+
+namespace
+{
+  //! metric names of the exposition format are [a-zA-Z_:][a-zA-Z0-9_:]*
+  std::string exposedName(std::string const & name)
+  {
+    std::string result(name);
+    for(std::size_t i = 0; i < result.size(); ++i)
+    {
+      char const c = result[i];
+      bool const valid = (c >= 'a' and c <= 'z') or (c >= 'A' and c <= 'Z') or c == '_' or c == ':' or
+                         (i > 0 and c >= '0' and c <= '9');
+      if(not valid)
+        result[i] = '_';
+    }
+    return result;
+  }
+}
+
+
+
+void Registry::writeText(std::ostream & out) const
+{
+  static double const quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+  boost::lock_guard<boost::mutex> guard(mutex);
+  for(std::map<std::string, Entry>::const_iterator it = metrics.begin(); it not_eq metrics.end(); ++it)
+  {
+    std::string const name = exposedName(it->first);
+    switch(it->second.type)
+    {
+      case counterType:
+        out << "# TYPE " << name << " counter\n"
+            << name << ' ' << static_cast<Counter const *>(it->second.metric)->value() << '\n';
+        break;
+
+      case gaugeType:
+        out << "# TYPE " << name << " gauge\n"
+            << name << ' ' << static_cast<Gauge const *>(it->second.metric)->value() << '\n';
+        break;
+
+      case histogramType:
+      {
+        Histogram::Snapshot const s = static_cast<Histogram const *>(it->second.metric)->snapshot();
+        out << "# TYPE " << name << " summary\n";
+        for(std::size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); ++q)
+          out << name << "{quantile=\"" << quantiles[q] << "\"} " << s.quantile(quantiles[q]) << '\n';
+        out << name << "{quantile=\"1\"} " << s.max() << '\n'
+            << name << "_sum " << s.sum << '\n'
+            << name << "_count " << s.count << '\n';
+        break;
+      }
+    }
+  }
+}
+
+
+
+void Registry::writeToFile(std::string const & fileName) const
+{
+  std::ofstream file(fileName.c_str());
+  if(not file)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::open, fileName));
+  writeText(file);
+  file.flush();
+  if(not file)
+    BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::write, fileName));
+}
+
+
+
+void Registry::writeToLog(Log::Severity severity) const
+{
+  std::ostringstream oss;
+  writeText(oss);
+  Log::log(oss.str(), severity);
+}
+
+
+
+
+} // end of namespace Metrics
+
+
+} // end of namespace uenf
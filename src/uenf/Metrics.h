@@ -0,0 +1,237 @@
+#ifndef UENF_METRICS_H
+#define UENF_METRICS_H
+
+
+#include <uenf/Log.h>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  Metrics that are cheap enough to stay enabled in production: counters, gauges and latency histograms.
+
+  Recording is wait-free (relaxed atomic adds only). Counters and histograms are sharded: each thread records
+  into one of several cache line separated shards, so threads on different cores do not contend, the shards
+  are merged when reading. Metrics are looked up by name in the registry once and then used via the returned
+  reference (the handle), which stays valid for the life time of the process:
+
+    static Metrics::Counter & hits = Metrics::Registry::global().counter("cache.hits");
+    ++hits;
+
+    static Metrics::Histogram & latency = Metrics::Registry::global().histogram("decoder.frame_ns");
+    {
+      Metrics::ScopedTimer timer(latency);
+      decodeFrame();
+    }
+
+    Metrics::Registry::global().writeToFile("metrics.txt"); // text exposition format (as used by Prometheus)
+*/
+namespace Metrics
+{
+
+
+
+
+enum { maxShards = 16, cacheLineSize = 64 };
+
+namespace detail
+{
+  //! the shard of the calling thread (threads are assigned round-robin)
+  unsigned int shardIndex();
+}
+
+
+
+
+class Counter : boost::noncopyable
+{
+public:
+  Counter() { for(int i = 0; i < maxShards; ++i) shards[i].value = 0; }
+
+  void add(boost::uint64_t n) { shards[detail::shardIndex()].value.fetch_add(n, boost::memory_order_relaxed); }
+  Counter & operator++() { add(1); return *this; }
+  Counter & operator+=(boost::uint64_t n) { add(n); return *this; }
+
+  //! sum over all shards
+  boost::uint64_t value() const;
+
+private:
+  struct Shard
+  {
+    alignas(cacheLineSize) boost::atomic<boost::uint64_t> value;
+  };
+  Shard shards[maxShards];
+};
+
+
+
+
+//! a value that goes up and down, like the number of running threads
+class Gauge : boost::noncopyable
+{
+public:
+  Gauge():current(0) {}
+
+  void set(boost::int64_t v) { current.store(v, boost::memory_order_relaxed); }
+  void add(boost::int64_t n) { current.fetch_add(n, boost::memory_order_relaxed); }
+  Gauge & operator++() { add(1);  return *this; }
+  Gauge & operator--() { add(-1); return *this; }
+
+  boost::int64_t value() const { return current.load(boost::memory_order_relaxed); }
+
+private:
+  boost::atomic<boost::int64_t> current;
+};
+
+
+
+
+/*!
+  HDR-style histogram of non-negative integer values (typically nanoseconds): values below 16 have exact
+  buckets, above that each power of two is split into 16 linear buckets, so the relative error of a reported
+  quantile is at most 1/16 over the full 64 bit range.
+*/
+class Histogram : boost::noncopyable
+{
+public:
+  enum { subBucketBits = 4, subBuckets = 1 << subBucketBits, bucketCount = (64 - subBucketBits + 1) * subBuckets,
+         shardCount = 8 };
+
+  Histogram();
+
+  void record(boost::uint64_t value)
+  {
+    Shard & shard = shards[detail::shardIndex() % shardCount];
+    shard.buckets[bucketOf(value)].fetch_add(1, boost::memory_order_relaxed);
+    shard.sum.fetch_add(value, boost::memory_order_relaxed);
+  }
+
+  //! merged over all shards
+  struct Snapshot
+  {
+    Snapshot():count(0), sum(0), buckets(bucketCount, 0) {}
+    boost::uint64_t count;
+    boost::uint64_t sum;
+    std::vector<boost::uint64_t> buckets;
+
+    //! q in [0, 1], returns the middle of the bucket the quantile falls into, 0 if empty
+    boost::uint64_t quantile(double q) const;
+    boost::uint64_t max() const;
+    double mean() const { return count ? double(sum) / double(count) : 0.0; }
+  };
+
+  Snapshot snapshot() const;
+
+  static unsigned int bucketOf(boost::uint64_t value)
+  {
+    if(value < subBuckets)
+      return unsigned(value);
+    unsigned int const exponent = 63 - unsigned(__builtin_clzll(value)); // >= subBucketBits
+    unsigned int const sub = unsigned(value >> (exponent - subBucketBits)) & (subBuckets - 1);
+    return (exponent - subBucketBits + 1) * subBuckets + sub;
+  }
+
+  static boost::uint64_t lowerBoundOf(unsigned int bucket);
+
+private:
+  struct Shard
+  {
+    alignas(cacheLineSize) boost::atomic<boost::uint64_t> sum;
+    boost::atomic<boost::uint64_t> buckets[bucketCount];
+  };
+  Shard shards[shardCount];
+};
+
+
+
+
+//! records the nanoseconds from construction to destruction into a histogram
+class ScopedTimer : boost::noncopyable
+{
+public:
+  explicit ScopedTimer(Histogram & histogramArg):histogram(histogramArg), start(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer()
+  {
+    histogram.record(boost::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now() - start).count()));
+  }
+
+private:
+  Histogram & histogram;
+  std::chrono::steady_clock::time_point const start;
+};
+
+
+
+
+/*!
+  All metrics by name. Names are free form, for the export dots and other characters invalid in the exposition
+  format are replaced by underscores. Asking for an existing name of another type throws an ExceptionParameter.
+  Metrics are never deleted, so the references returned can be kept as handles.
+*/
+class Registry : boost::noncopyable
+{
+public:
+  Registry() {}
+  ~Registry();
+
+  //! the process wide registry (a wanted leak like the logger list in Log.cpp)
+  static Registry & global();
+
+  Counter   & counter  (std::string const & name);
+  Gauge     & gauge    (std::string const & name);
+  Histogram & histogram(std::string const & name);
+
+  //! a consistent list of all metrics and their current values in the text exposition format
+  void writeText(std::ostream & out) const;
+
+  //! throws an ExceptionIO if the file cannot be written
+  void writeToFile(std::string const & fileName) const;
+
+  //! logs the text exposition via Log::log, one message for all metrics
+  void writeToLog(Log::Severity severity = Log::info) const;
+
+private:
+  enum Type { counterType, gaugeType, histogramType };
+
+  struct Entry
+  {
+    Type type;
+    void * metric;
+  };
+
+  void * find(std::string const & name, Type type);
+
+  mutable boost::mutex mutex;
+  std::map<std::string, Entry> metrics;
+};
+
+
+
+
+} // end of namespace Metrics
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,223 @@
+
+
+
+#include <uenf/Resample.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+
+#include <map>
+#include <cmath>
+#include <algorithm>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+namespace Resample
+{
+
+
+namespace
+{
+
+  double const pi = 3.14159265358979323846;
+
+
+  // support of the kernel in source pixels at scale one
+  double support(Filter filter)
+  {
+    switch(filter)
+    {
+      case nearest:  return 0.5;
+      case bilinear: return 1.0;
+      case bicubic:  return 2.0;
+      case lanczos3: return 3.0;
+      case gaussian: return 1.5;
+      default:
+        BOOST_THROW_EXCEPTION(ExceptionParameter(2));
+    }
+  }
+
+
+  double sinc(double x)
+  {
+    if(std::fabs(x) < 1e-8)
+      return 1.0;
+    x *= pi;
+    return std::sin(x) / x;
+  }
+
+
+  double kernel(Filter filter, double x)
+  {
+    x = std::fabs(x);
+    switch(filter)
+    {
+      case bilinear:
+        return x < 1.0 ? 1.0 - x : 0.0;
+
+      case bicubic: // Catmull-Rom (a = -0.5)
+        if(x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+        if(x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+        return 0.0;
+
+      case lanczos3:
+        return x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+
+      case gaussian: // sigma 0.5, truncated at three sigma
+        return x < 1.5 ? std::exp(-2.0 * x * x) : 0.0;
+
+      default:
+        BOOST_THROW_EXCEPTION(ExceptionParameter(0));
+    }
+  }
+
+
+
+  typedef boost::tuple<int, int, int> CacheKey;
+
+  struct CacheEntry
+  {
+    boost::shared_ptr<WeightTable const> table;
+    unsigned long lastUse; // of the use counter below, for evicting the least recently used table
+  };
+
+  typedef std::map<CacheKey, CacheEntry> Cache;
+
+  unsigned long cacheUses = 0; // guarded by the cache mutex
+
+  //! evicts the least recently used tables beyond WeightTable::maxCachedTables, called with the cache mutex held
+  void evict(Cache & cache)
+  {
+    while(cache.size() > WeightTable::maxCachedTables)
+    {
+      Cache::iterator oldest = cache.begin();
+      for(Cache::iterator it = cache.begin(); it not_eq cache.end(); ++it)
+        if(it->second.lastUse < oldest->second.lastUse)
+          oldest = it;
+      cache.erase(oldest);
+    }
+  }
+
+  // like the logger list in Log.cpp, these are wanted leaks to stay valid during static destruction
+  Cache * getCache()
+  {
+    static Cache * cachePtr = new Cache;
+    return cachePtr;
+  }
+
+  boost::mutex * getCacheMutex()
+  {
+    static boost::mutex * mutexPtr = new boost::mutex;
+    return mutexPtr;
+  }
+
+}  // end of anonymous namespace
+
+
+
+
+
+
+WeightTable::WeightTable(int sourceSizeArg, int destinationSizeArg, Filter filterArg):
+  sourceSize(sourceSizeArg), destinationSize(destinationSizeArg), filter(filterArg), taps(1)
+{
+  if(sourceSize < 1 or destinationSize < 1)
+    BOOST_THROW_EXCEPTION(ExceptionParameter(sourceSize < 1 ? 0 : 1));
+
+  double const scale = double(sourceSize) / double(destinationSize);
+
+  if(filter == nearest)
+  {
+    indexTable.resize(destinationSize);
+    weightTable.assign(destinationSize, 1.0f);
+    for(int i = 0; i < destinationSize; ++i)
+      indexTable[i] = std::min(sourceSize - 1, int((i + 0.5) * scale));
+    return;
+  }
+
+  // when downscaling, the kernel is stretched by the scale to avoid aliasing
+  double const stretch = std::max(1.0, scale);
+  double const radius = support(filter) * stretch;
+  taps = int(std::ceil(radius)) * 2 + 1;
+
+  indexTable.resize(std::size_t(destinationSize) * taps);
+  weightTable.resize(std::size_t(destinationSize) * taps);
+
+  std::vector<double> w(taps);
+  for(int i = 0; i < destinationSize; ++i)
+  {
+    double const center = (i + 0.5) * scale - 0.5;
+    int const first = int(std::floor(center - radius)) + 1;
+    double sum = 0.0;
+    for(int k = 0; k < taps; ++k)
+    {
+      w[k] = kernel(filter, (first + k - center) / stretch);
+      sum += w[k];
+    }
+    for(int k = 0; k < taps; ++k)
+    {
+      std::size_t const entry = std::size_t(i) * taps + k;
+      indexTable[entry]  = std::min(sourceSize - 1, std::max(0, first + k));
+      weightTable[entry] = float(sum not_eq 0.0 ? w[k] / sum : (k == taps / 2 ? 1.0 : 0.0));
+    }
+  }
+}
+
+
+
+boost::shared_ptr<WeightTable const> WeightTable::get(int sourceSize, int destinationSize, Filter filter)
+{
+  CacheKey const key(sourceSize, destinationSize, int(filter));
+  {
+    boost::unique_lock<boost::mutex> guard(*getCacheMutex());
+    Cache::iterator it = getCache()->find(key);
+    if(it not_eq getCache()->end())
+    {
+      it->second.lastUse = ++cacheUses;
+      return it->second.table;
+    }
+  }
+
+  // computed outside of the lock, if two threads race here, the first one inserted wins
+  boost::shared_ptr<WeightTable const> table = boost::make_shared<WeightTable>(sourceSize, destinationSize, filter);
+
+  boost::unique_lock<boost::mutex> guard(*getCacheMutex());
+  CacheEntry entry;
+  entry.table = table;
+  entry.lastUse = ++cacheUses;
+  std::pair<Cache::iterator, bool> const inserted = getCache()->insert(Cache::value_type(key, entry));
+  inserted.first->second.lastUse = entry.lastUse;
+  table = inserted.first->second.table;
+  evict(*getCache());
+  return table;
+}
+
+
+
+std::size_t WeightTable::cacheSize()
+{
+  boost::unique_lock<boost::mutex> guard(*getCacheMutex());
+  return getCache()->size();
+}
+
+
+
+void WeightTable::clearCache()
+{
+  boost::unique_lock<boost::mutex> guard(*getCacheMutex());
+  getCache()->clear();
+}
+
+
+
+
+}  // end of namespace Resample
+
+
+}  // end of namespace uenf
@@ -0,0 +1,260 @@
+#ifndef UENF_RESAMPLE_H
+#define UENF_RESAMPLE_H
+
+
+#include <uenf/Image.h>
+#include <uenf/Exceptions.h>
+
+#include <Eigen/Core>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+#include <ciso646>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  Resampling of images (scaling up or down) with a separable filter.
+
+  The weights of a separable filter only depend on the source size, destination size and the filter kernel,
+  so they are computed once per such triple and kept in a bounded process wide cache (see WeightTable::get). A Resampler
+  instance additionally holds on to its tables and its intermediate buffers, so resampling frames of a constant
+  size neither recomputes weights nor allocates. Typical usage:
+
+    Resample::Resampler resampler(Resample::lanczos3);
+    while(grabFrame(src))
+    {
+      resampler.resample(src, dst, src.width() / 2, src.height() / 2);
+      ...
+    }
+*/
+namespace Resample
+{
+
+
+
+
+enum Filter { nearest, bilinear, bicubic, lanczos3, gaussian };
+
+
+
+
+/*! Precomputed weights for one dimension. For each destination index there are exactly "taps" entries of
+    (source index, weight), source indices are already clamped to the border, so the kernels do not need
+    any border handling. Weights of a destination index sum up to one.
+*/
+class WeightTable : boost::noncopyable
+{
+public:
+  WeightTable(int sourceSize, int destinationSize, Filter filter);
+
+  //! the cache keeps at most this many tables, evicting the least recently requested one
+  enum { maxCachedTables = 64 };
+
+  /*! returns the table from the process wide cache, computing it only upon first request (thread-safe); evicted
+      tables stay valid as long as somebody (like a Resampler) holds them
+  */
+  static boost::shared_ptr<WeightTable const> get(int sourceSize, int destinationSize, Filter filter);
+  //! number of tables in the cache (mainly for diagnostics)
+  static std::size_t cacheSize();
+  static void clearCache();
+
+  int const sourceSize;
+  int const destinationSize;
+  Filter const filter;
+  int taps;
+
+  int   const * indices(int destinationIndex) const { return &indexTable [std::size_t(destinationIndex) * taps]; }
+  float const * weights(int destinationIndex) const { return &weightTable[std::size_t(destinationIndex) * taps]; }
+
+private:
+  std::vector<int>   indexTable;
+  std::vector<float> weightTable;
+};
+
+
+
+
+namespace detail
+{
+
+  template<typename T> inline T fromFloat(float v)
+  {
+    // round and saturate for integer types
+    if(v <= float(std::numeric_limits<T>::min())) return std::numeric_limits<T>::min();
+    if(v >= float(std::numeric_limits<T>::max())) return std::numeric_limits<T>::max();
+    return T(v + 0.5f);
+  }
+
+  template<> inline float fromFloat<float>(float v) { return v; }
+
+
+
+  /*! horizontal pass: source rows to float rows of the destination width. The filter runs along the rows, so
+      bands of rows are transposed into columns (converting to float) first: each destination column then is a
+      weighted sum of whole source columns of the band, vectorized via Eigen like the vertical pass, and is
+      transposed back into the rows of tmp. The bands keep both buffers in the cache.
+  */
+  template<typename T> void horizontalPass(Image<T> const & src, Image<float> & tmp, WeightTable const & table,
+                                           Eigen::ArrayXf & columns, Eigen::ArrayXf & filtered)
+  {
+    typedef Eigen::Map<Eigen::ArrayXf const> ConstColumn;
+    enum { bandRows = 32 };
+    int const channels = src.channels();
+    int const taps = table.taps;
+    int const srcWidth = src.width();
+    int const dstWidth = table.destinationSize;
+    columns.resize(std::ptrdiff_t(srcWidth) * bandRows * channels);
+    filtered.resize(std::ptrdiff_t(dstWidth) * bandRows * channels);
+    for(int band = 0; band < src.height(); band += bandRows)
+    {
+      int const rows = std::min(int(bandRows), src.height() - band);
+      int const column = rows * channels; // elements of a column of the band
+
+      for(int r = 0; r < rows; ++r)
+      {
+        T const * in = src.row(band + r);
+        float * out = &columns[r * channels];
+        for(int x = 0; x < srcWidth; ++x, in += channels, out += column)
+          for(int c = 0; c < channels; ++c)
+            out[c] = float(in[c]);
+      }
+
+      for(int x = 0; x < dstWidth; ++x)
+      {
+        int   const * idx = table.indices(x);
+        float const * w   = table.weights(x);
+        Eigen::Map<Eigen::ArrayXf> out(&filtered[std::ptrdiff_t(x) * column], column);
+        out = w[0] * ConstColumn(&columns[std::ptrdiff_t(idx[0]) * column], column);
+        for(int k = 1; k < taps; ++k)
+          out += w[k] * ConstColumn(&columns[std::ptrdiff_t(idx[k]) * column], column);
+      }
+
+      for(int r = 0; r < rows; ++r)
+      {
+        float const * in = &filtered[r * channels];
+        float * out = tmp.row(band + r);
+        for(int x = 0; x < dstWidth; ++x, in += column, out += channels)
+          for(int c = 0; c < channels; ++c)
+            out[c] = in[c];
+      }
+    }
+  }
+
+
+  //! vertical pass: weighted sum of complete intermediate rows, vectorized over the whole row via Eigen
+  template<typename T> void verticalPass(Image<float> const & tmp, Image<T> & dst, WeightTable const & table,
+                                         Eigen::ArrayXf & accumulator)
+  {
+    typedef Eigen::Map<Eigen::ArrayXf const> ConstRow;
+    int const elements = dst.width() * dst.channels();
+    int const taps = table.taps;
+    accumulator.resize(elements);
+    for(int y = 0; y < dst.height(); ++y)
+    {
+      int   const * idx = table.indices(y);
+      float const * w   = table.weights(y);
+      accumulator = w[0] * ConstRow(tmp.row(idx[0]), elements);
+      for(int k = 1; k < taps; ++k)
+        accumulator += w[k] * ConstRow(tmp.row(idx[k]), elements);
+      T * dstRow = dst.row(y);
+      for(int i = 0; i < elements; ++i)
+        dstRow[i] = fromFloat<T>(accumulator[i]);
+    }
+  }
+
+  template<> inline void verticalPass<float>(Image<float> const & tmp, Image<float> & dst, WeightTable const & table,
+                                             Eigen::ArrayXf &)
+  {
+    typedef Eigen::Map<Eigen::ArrayXf const> ConstRow;
+    int const elements = dst.width() * dst.channels();
+    int const taps = table.taps;
+    for(int y = 0; y < dst.height(); ++y)
+    {
+      int   const * idx = table.indices(y);
+      float const * w   = table.weights(y);
+      Eigen::Map<Eigen::ArrayXf> out(dst.row(y), elements);
+      out = w[0] * ConstRow(tmp.row(idx[0]), elements);
+      for(int k = 1; k < taps; ++k)
+        out += w[k] * ConstRow(tmp.row(idx[k]), elements);
+    }
+  }
+
+} // end of namespace detail
+
+
+
+
+/*!
+  Resamples images with a fixed filter. Holds the weight tables of the last used sizes and the intermediate
+  buffer, so calling resample() repeatedly with the same sizes does no computation of weights and no allocation.
+  An instance is not thread-safe, use one per thread (the underlying weight cache is shared anyway).
+*/
+class Resampler
+{
+public:
+  explicit Resampler(Filter filterArg = bilinear):filter(filterArg) {}
+
+  Filter getFilter() const { return filter; }
+
+  //! dst is resized to the given size (which does not allocate, if it already has that size)
+  template<typename T> void resample(Image<T> const & src, Image<T> & dst, int dstWidth, int dstHeight)
+  {
+    if(src.empty() or dstWidth < 1 or dstHeight < 1)
+      BOOST_THROW_EXCEPTION(ExceptionParameter(src.empty() ? 0 : 2));
+    dst.resize(dstWidth, dstHeight, src.channels());
+    resample(src, dst);
+  }
+
+  //! resamples into the already sized dst image
+  template<typename T> void resample(Image<T> const & src, Image<T> & dst)
+  {
+    if(src.channels() not_eq dst.channels() or src.empty() or dst.empty())
+      BOOST_THROW_EXCEPTION(ExceptionParameter(1));
+    prepare(src.width(), src.height(), dst.width(), dst.height());
+    intermediate.resize(dst.width(), src.height(), src.channels());
+    detail::horizontalPass(src, intermediate, *horizontal, columns, filtered);
+    detail::verticalPass(intermediate, dst, *vertical, accumulator);
+  }
+
+private:
+  void prepare(int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+  {
+    if(not horizontal or horizontal->sourceSize not_eq srcWidth or horizontal->destinationSize not_eq dstWidth)
+      horizontal = WeightTable::get(srcWidth, dstWidth, filter);
+    if(not vertical or vertical->sourceSize not_eq srcHeight or vertical->destinationSize not_eq dstHeight)
+      vertical = WeightTable::get(srcHeight, dstHeight, filter);
+  }
+
+  Filter filter;
+  boost::shared_ptr<WeightTable const> horizontal;
+  boost::shared_ptr<WeightTable const> vertical;
+  Image<float> intermediate;
+  Eigen::ArrayXf columns;  // the transposed band of the horizontal pass
+  Eigen::ArrayXf filtered; // and its result
+  Eigen::ArrayXf accumulator;
+};
+
+
+
+
+} // end of namespace Resample
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,208 @@
+
+
+
+#include <uenf/Signal.h>
+
+#include <boost/thread/locks.hpp>
+
+#include <algorithm>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+
+namespace detail
+{
+
+
+
+SignalCore::~SignalCore()
+{
+  // no emit can be running anymore, as the owning signal is gone
+  delete current.load();
+  for(std::size_t i = 0; i < retired.size(); ++i)
+    delete retired[i];
+  for(std::size_t i = 0; i < spare.size(); ++i)
+    delete spare[i];
+}
+
+
+
+void SignalCore::connect(boost::shared_ptr<SlotBase> const & slot)
+{
+  boost::unique_lock<boost::mutex> guard(writeMutex);
+  Snapshot const * old = current.load();
+  Snapshot & next = fresh();
+  try
+  {
+    if(old)
+      next.assign(old->begin(), old->end());
+    next.push_back(slot);
+  }
+  catch(...)
+  {
+    next.clear();
+    throw;
+  }
+  publish(&next);
+}
+
+
+
+void SignalCore::disconnect(SlotBase * slot)
+{
+  slot->connected = false; // from now on, emits skip the slot even if they still see it in their snapshot
+  try
+  {
+    boost::unique_lock<boost::mutex> guard(writeMutex);
+    Snapshot const * old = current.load();
+    if(not old)
+      return;
+    Snapshot & next = fresh();
+    try
+    {
+      next.reserve(old->size());
+      for(Snapshot::const_iterator it = old->begin(); it not_eq old->end(); ++it)
+        if(it->get() not_eq slot)
+          next.push_back(*it);
+    }
+    catch(...)
+    {
+      next.clear();
+      throw;
+    }
+    publish(&next);
+  }
+  catch(...) // out of memory, the slot stays in the snapshot, but is skipped anyway
+  {}
+}
+
+
+
+void SignalCore::disconnectAll()
+{
+  try
+  {
+    boost::unique_lock<boost::mutex> guard(writeMutex);
+    Snapshot const * old = current.load();
+    if(not old)
+      return;
+    for(Snapshot::const_iterator it = old->begin(); it not_eq old->end(); ++it)
+      (*it)->connected = false;
+    reserve();
+    publish(0);
+  }
+  catch(...) // locking failed or out of memory, the slots stay in the snapshot, but are skipped anyway
+  {}
+}
+
+
+
+std::size_t SignalCore::size() const
+{
+  boost::unique_lock<boost::mutex> guard(writeMutex);
+  Snapshot const * snapshot = current.load();
+  return snapshot ? snapshot->size() : 0;
+}
+
+
+
+void SignalCore::reserve()
+{
+  // called with writeMutex locked, makes room for publishing one more snapshot, so that neither publish nor
+  // collectLocked throws: every snapshot may end up in retired or spare
+  retired.reserve(retired.size() + 1);
+  spare.reserve(spare.size() + retired.size() + 1);
+}
+
+
+
+SignalCore::Snapshot & SignalCore::fresh()
+{
+  // called with writeMutex locked, the snapshot stays in spare until published, so it is not lost if filling
+  // it throws
+  reserve();
+  if(spare.empty())
+    spare.push_back(new Snapshot);
+  return *spare.back();
+}
+
+
+
+void SignalCore::publish(Snapshot * next)
+{
+  // called with writeMutex locked, next is 0 or the snapshot returned by fresh
+  if(next)
+    spare.pop_back();
+  Snapshot * old = current.exchange(next);
+  if(old)
+    retired.push_back(old);
+  collectLocked();
+}
+
+
+
+void SignalCore::collect()
+{
+  try
+  {
+    boost::unique_lock<boost::mutex> guard(writeMutex);
+    collectLocked();
+  }
+  catch(...) // locking failed, the next writer collects
+  {}
+}
+
+
+
+void SignalCore::collectLocked()
+{
+  // An emit counting itself as user of a retired snapshot after we see no users here will not use it, as it
+  // finds the snapshot not current anymore (both are sequentially consistent) and tries again. It may still
+  // decrement the count, which is why the snapshot is kept in spare instead of being deleted.
+  std::size_t kept = 0;
+  for(std::size_t i = 0; i < retired.size(); ++i)
+    if(retired[i]->users.load() == 0)
+    {
+      retired[i]->clear();
+      spare.push_back(retired[i]);
+    }
+    else
+      retired[kept++] = retired[i];
+  retired.resize(kept);
+}
+
+
+
+}  // end of namespace detail
+
+
+
+
+
+
+
+void Connection::disconnect()
+{
+  boost::shared_ptr<detail::SignalCore> lockedSignal = signal.lock();
+  boost::shared_ptr<detail::SlotBase>   lockedSlot   = slot.lock();
+  if(lockedSignal and lockedSlot)
+    lockedSignal->disconnect(lockedSlot.get());
+  signal.reset();
+  slot.reset();
+}
+
+
+
+bool Connection::connected() const
+{
+  boost::shared_ptr<detail::SlotBase> lockedSlot = slot.lock();
+  return lockedSlot and lockedSlot->connected and not signal.expired();
+}
+
+
+
+
+}  // end of namespace uenf
@@ -0,0 +1,276 @@
+#ifndef UENF_SIGNAL_H
+#define UENF_SIGNAL_H
+
+
+#include <uenf/SmallFunction.h>
+#include <uenf/EventTarget.h>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <vector>
+#include <utility>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+namespace detail
+{
+
+  class SlotBase : boost::noncopyable
+  {
+  public:
+    SlotBase():connected(true) {}
+    boost::atomic<bool> connected;
+  };
+
+
+
+  /*! The non-template part of a signal: an immutable snapshot of the connected slots is published atomically,
+      emitting only loads the current snapshot and counts itself as one of its users (see ReadGuard). Writers
+      fill a new snapshot under a mutex, publish it and retire the old one. A retired snapshot is released by
+      whoever sees it unused, the writer retiring it or the emit that was its last user: its slots are dropped
+      right away, the snapshot itself is kept for reuse until the signal is gone. So an emit may count itself
+      as user of a snapshot retired meanwhile without touching freed memory, it just tries again then.
+  */
+  class SignalCore : boost::noncopyable
+  {
+  public:
+    class Snapshot : public std::vector<boost::shared_ptr<SlotBase> >
+    {
+    public:
+      Snapshot():users(0) {}
+      mutable boost::atomic<unsigned int> users; //!< emits iterating this snapshot
+    };
+
+    SignalCore():current(0) {}
+    ~SignalCore();
+
+    void connect(boost::shared_ptr<SlotBase> const & slot);
+    void disconnect(SlotBase * slot); // nothrow
+    void disconnectAll();             // nothrow
+    std::size_t size() const;
+    bool empty() const { return current.load() == 0; }
+
+    //! keeps the snapshot loaded within its lifetime alive
+    class ReadGuard : boost::noncopyable
+    {
+    public:
+      explicit ReadGuard(SignalCore & coreArg):core(coreArg), loaded(coreArg.acquire()) {}
+      ~ReadGuard() { core.release(loaded); }
+      Snapshot const * snapshot() const { return loaded; }
+    private:
+      SignalCore & core;
+      Snapshot const * loaded;
+    };
+
+  private:
+    Snapshot const * acquire()
+    {
+      for(;;)
+      {
+        Snapshot const * snapshot = current.load();
+        if(not snapshot)
+          return 0;
+        ++snapshot->users;
+        if(current.load() == snapshot) // not retired before we counted, so it is not released before we are done
+          return snapshot;
+        release(snapshot);
+      }
+    }
+
+    void release(Snapshot const * snapshot)
+    {
+      if(snapshot and --snapshot->users == 0 and snapshot not_eq current.load())
+        collect();
+    }
+
+    void reserve();
+    Snapshot & fresh();
+    void publish(Snapshot * next);
+    void collect();       // nothrow
+    void collectLocked(); // nothrow, needs the writeMutex
+
+    boost::atomic<Snapshot *> current;
+    mutable boost::mutex writeMutex;
+    std::vector<Snapshot *> retired; //!< possibly still iterated by emits
+    std::vector<Snapshot *> spare;   //!< released, empty and unused
+  };
+
+} // end of namespace detail
+
+
+
+
+/*!
+  Handle of a connection between a signal and a slot, copyable and safe to use after the signal is gone.
+*/
+class Connection
+{
+public:
+  Connection() {}
+  Connection(boost::weak_ptr<detail::SignalCore> const & signalArg, boost::weak_ptr<detail::SlotBase> const & slotArg):
+    signal(signalArg), slot(slotArg) {}
+
+  /*! After returning, the slot will not be called by emits starting later on. An emit running concurrently in
+      another thread may still be within the slot. Can be called from within the slot itself.
+  */
+  void disconnect();
+  bool connected() const;
+
+private:
+  boost::weak_ptr<detail::SignalCore> signal;
+  boost::weak_ptr<detail::SlotBase> slot;
+};
+
+
+
+
+//! Disconnects upon destruction, typically a member of the object owning the slot.
+class ScopedConnection : boost::noncopyable
+{
+public:
+  ScopedConnection() {}
+  ScopedConnection(Connection const & connectionArg):connection(connectionArg) {}
+  ~ScopedConnection() { connection.disconnect(); }
+
+  //! disconnects the current connection
+  ScopedConnection & operator=(Connection const & other)
+  {
+    connection.disconnect();
+    connection = other;
+    return *this;
+  }
+
+  void disconnect() { connection.disconnect(); }
+  bool connected() const { return connection.connected(); }
+
+  //! the connection will not be disconnected by this object anymore
+  Connection release()
+  {
+    Connection released = connection;
+    connection = Connection();
+    return released;
+  }
+
+private:
+  Connection connection;
+};
+
+
+
+
+
+template<typename Signature> class Signal;
+
+
+
+
+/*!
+  Type-safe signal with any number of connected slots (see doc/sig_slot_gedanken.txt):
+
+    Signal<void (int, std::string const &)> valueChanged;
+    ScopedConnection c = valueChanged.connect(boost::bind(&View::update, &view, _1, _2));
+    valueChanged(42, "answer");
+
+  Emitting does not lock, it iterates a snapshot of the connections that is published atomically upon
+  connect/disconnect, so connecting and disconnecting from any thread (even from within a slot) is safe
+  while emits are running. Slots are stored in a SmallFunction, so small callables need no heap allocation.
+
+  Direct connections call the slot in the emitting thread. Queued connections (connect with an EventTarget)
+  copy the arguments and post the call to the target's event loop (see EventLoop.h), the slot is skipped,
+  if it was disconnected before the event is processed. The target has to outlive the connection.
+
+  An exception thrown by a direct slot leaves emit(), the remaining slots are not called.
+*/
+template<typename... Args> class Signal<void (Args...)> : boost::noncopyable
+{
+public:
+  typedef SmallFunction<void (Args...)> SlotFunction;
+
+  Signal():core(boost::make_shared<detail::SignalCore>()) {}
+  ~Signal() { core->disconnectAll(); }
+
+  //! direct connection
+  template<typename F> Connection connect(F && f)
+  {
+    return connectSlot(boost::make_shared<Slot>(SlotFunction(std::forward<F>(f)), static_cast<EventTarget *>(0)));
+  }
+
+  //! queued connection, the slot is executed in the event loop of target
+  template<typename F> Connection connect(F && f, EventTarget & target)
+  {
+    return connectSlot(boost::make_shared<Slot>(SlotFunction(std::forward<F>(f)), &target));
+  }
+
+  void disconnectAll() { core->disconnectAll(); }
+
+  //! number of connected slots
+  std::size_t size() const { return core->size(); }
+
+  void operator()(Args... args) const { emit(args...); }
+
+  void emit(Args... args) const
+  {
+    if(core->empty()) // saves the user count round trip for unconnected signals
+      return;
+    detail::SignalCore::ReadGuard guard(*core);
+    detail::SignalCore::Snapshot const * snapshot = guard.snapshot();
+    if(not snapshot)
+      return;
+    for(detail::SignalCore::Snapshot::const_iterator it = snapshot->begin(); it not_eq snapshot->end(); ++it)
+    {
+      Slot * slot = static_cast<Slot *>(it->get());
+      if(not slot->connected.load(boost::memory_order_acquire))
+        continue;
+      if(slot->target)
+        post(boost::static_pointer_cast<Slot>(*it), args...);
+      else
+        slot->function(args...);
+    }
+  }
+
+private:
+  struct Slot : public detail::SlotBase
+  {
+    Slot(SlotFunction const & functionArg, EventTarget * targetArg):function(functionArg), target(targetArg) {}
+    SlotFunction function;
+    EventTarget * target;
+  };
+
+  Connection connectSlot(boost::shared_ptr<Slot> const & slot)
+  {
+    core->connect(slot);
+    return Connection(core, slot);
+  }
+
+  static void post(boost::shared_ptr<Slot> const & slot, Args... args)
+  {
+    slot->target->postEvent([slot, args...]() mutable
+    {
+      if(slot->connected.load(boost::memory_order_acquire))
+        slot->function(args...);
+    });
+  }
+
+  boost::shared_ptr<detail::SignalCore> core;
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef UENF_SMALLFUNCTION_H
+#define UENF_SMALLFUNCTION_H
+
+
+#include <uenf/Exceptions.h>
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+template<typename Signature, std::size_t BufferSize = 6 * sizeof(void *)> class SmallFunction;
+
+
+
+
+/*!
+  A type-erased callable like boost::function, but callables up to BufferSize bytes (like a member function
+  pointer bound to an object and a few arguments, or a small lambda) are stored in place, so constructing,
+  copying and calling it does not touch the heap. Larger callables are allocated on the heap transparently.
+
+    SmallFunction<void (int)> f = boost::bind(&Widget::setValue, widget, _1);
+    f(42);
+
+  Calling an empty SmallFunction throws an ExceptionCode.
+*/
+template<typename R, typename... Args, std::size_t BufferSize> class SmallFunction<R (Args...), BufferSize>
+{
+public:
+  SmallFunction():ops(0) {}
+
+  template<typename F, typename = typename std::enable_if<
+             not std::is_same<typename std::decay<F>::type, SmallFunction>::value>::type>
+  SmallFunction(F && f):ops(0)
+  {
+    typedef typename std::decay<F>::type Functor;
+    assign<Functor>(std::forward<F>(f), std::integral_constant<bool, fitsInPlace<Functor>()>());
+  }
+
+  SmallFunction(SmallFunction const & other):ops(other.ops)
+  {
+    if(ops)
+      ops->copy(&storage, &other.storage);
+  }
+
+  SmallFunction(SmallFunction && other) noexcept:ops(other.ops)
+  {
+    if(ops)
+    {
+      ops->move(&storage, &other.storage);
+      other.ops = 0;
+    }
+  }
+
+  SmallFunction & operator=(SmallFunction const & other)
+  {
+    if(this not_eq &other)
+    {
+      SmallFunction copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  SmallFunction & operator=(SmallFunction && other) noexcept
+  {
+    if(this not_eq &other)
+    {
+      reset();
+      if(other.ops)
+      {
+        other.ops->move(&storage, &other.storage);
+        ops = other.ops;
+        other.ops = 0;
+      }
+    }
+    return *this;
+  }
+
+  ~SmallFunction()
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    if(ops)
+    {
+      ops->destroy(&storage);
+      ops = 0;
+    }
+  }
+
+  bool empty() const { return ops == 0; }
+  explicit operator bool() const { return ops not_eq 0; }
+
+  R operator()(Args... args) const
+  {
+    if(not ops)
+      BOOST_THROW_EXCEPTION(ExceptionCode("call of an empty SmallFunction"));
+    return ops->invoke(const_cast<Storage *>(&storage), std::forward<Args>(args)...);
+  }
+
+  //! true, if a callable of type F would be stored without heap allocation
+  template<typename F> static constexpr bool fitsInPlace()
+  {
+    return sizeof(F) <= BufferSize and alignof(F) <= alignof(std::max_align_t)
+           and std::is_nothrow_move_constructible<F>::value;
+  }
+
+private:
+  typedef typename std::aligned_storage<BufferSize, alignof(std::max_align_t)>::type Storage;
+
+  // one static table per stored callable type, the poor man's vtable without a virtual base in the buffer
+  struct Ops
+  {
+    R    (*invoke) (Storage * storage, Args &&... args);
+    void (*copy)   (Storage * destination, Storage const * source);
+    void (*move)   (Storage * destination, Storage * source); // nothrow, leaves the source destroyed
+    void (*destroy)(Storage * storage);
+  };
+
+  template<typename F> struct InPlace
+  {
+    static F * get(Storage * s)             { return static_cast<F *>(static_cast<void *>(s)); }
+    static F const * get(Storage const * s) { return static_cast<F const *>(static_cast<void const *>(s)); }
+
+    static R invoke(Storage * s, Args &&... args) { return (*get(s))(std::forward<Args>(args)...); }
+    static void copy(Storage * d, Storage const * s) { new (d) F(*get(s)); }
+    static void move(Storage * d, Storage * s) { new (d) F(std::move(*get(s))); get(s)->~F(); }
+    static void destroy(Storage * s) { get(s)->~F(); }
+
+    static Ops const * ops() { static Ops const table = { &invoke, &copy, &move, &destroy }; return &table; }
+  };
+
+  template<typename F> struct OnHeap
+  {
+    static F *& get(Storage * s)            { return *static_cast<F **>(static_cast<void *>(s)); }
+    static F * get(Storage const * s)       { return *static_cast<F * const *>(static_cast<void const *>(s)); }
+
+    static R invoke(Storage * s, Args &&... args) { return (*get(s))(std::forward<Args>(args)...); }
+    static void copy(Storage * d, Storage const * s) { get(d) = new F(*get(s)); }
+    static void move(Storage * d, Storage * s) { get(d) = get(s); get(s) = 0; }
+    static void destroy(Storage * s) { delete get(s); }
+
+    static Ops const * ops() { static Ops const table = { &invoke, &copy, &move, &destroy }; return &table; }
+  };
+
+  template<typename F, typename G> void assign(G && f, std::true_type)
+  {
+    new (&storage) F(std::forward<G>(f));
+    ops = InPlace<F>::ops();
+  }
+
+  template<typename F, typename G> void assign(G && f, std::false_type)
+  {
+    OnHeap<F>::get(&storage) = new F(std::forward<G>(f));
+    ops = OnHeap<F>::ops();
+  }
+
+  Storage storage;
+  Ops const * ops;
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,164 @@
+
+
+
+#include <uenf/ThreadPool.h>
+
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/exception_ptr.hpp>
+
+#include <algorithm>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+
+
+//! shared state of one parallelFor call, kept alive by all helpers still referring to it
+struct ThreadPool::Range
+{
+  Range(std::size_t countArg, std::size_t grainArg, RangeTask const & bodyArg):
+    count(countArg), grain(grainArg), next(0), remainingChunks((countArg + grainArg - 1) / grainArg), body(bodyArg) {}
+
+  std::size_t const count;
+  std::size_t const grain;
+  boost::atomic<std::size_t> next;
+  boost::atomic<std::size_t> remainingChunks;
+  RangeTask body;
+
+  boost::mutex mutex;
+  boost::condition_variable done;
+  boost::exception_ptr error;
+};
+
+
+
+
+
+ThreadPool::ThreadPool(unsigned int threadCountArg):threadCount(threadCountArg), stopping(false)
+{
+  if(not threadCount)
+    threadCount = std::max(1u, boost::thread::hardware_concurrency());
+  for(unsigned int i = 0; i < threadCount; ++i)
+    workers.create_thread(boost::bind(&ThreadPool::workerLoop, this));
+}
+
+
+
+ThreadPool::~ThreadPool()
+{
+  {
+    boost::lock_guard<boost::mutex> guard(mutex);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  workers.join_all();
+}
+
+
+
+ThreadPool & ThreadPool::global()
+{
+  // like the logger list in Log.cpp, this is a wanted leak (workers would be joined during static destruction otherwise)
+  static ThreadPool * poolPtr = new ThreadPool(std::max(2u, boost::thread::hardware_concurrency()) - 1);
+  return *poolPtr;
+}
+
+
+
+void ThreadPool::post(Task const & task)
+{
+  {
+    boost::lock_guard<boost::mutex> guard(mutex);
+    tasks.push_back(task);
+  }
+  wakeup.notify_one();
+}
+
+
+
+void ThreadPool::workerLoop()
+{
+  while(true)
+  {
+    Task task;
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while(tasks.empty() and not stopping)
+        wakeup.wait(lock);
+      if(tasks.empty()) // stopping and nothing left to do
+        return;
+      task.swap(tasks.front());
+      tasks.pop_front();
+    }
+    try
+    {
+      task();
+    }
+    catch(...) // see class documentation
+    {}
+  }
+}
+
+
+
+void ThreadPool::runChunks(boost::shared_ptr<Range> range)
+{
+  while(true)
+  {
+    std::size_t const begin = range->next.fetch_add(range->grain);
+    if(begin >= range->count)
+      return;
+    try
+    {
+      range->body(begin, std::min(begin + range->grain, range->count));
+    }
+    catch(...)
+    {
+      boost::lock_guard<boost::mutex> guard(range->mutex);
+      if(not range->error)
+        range->error = boost::current_exception();
+    }
+    if(--range->remainingChunks == 0)
+    {
+      boost::lock_guard<boost::mutex> guard(range->mutex);
+      range->done.notify_all();
+    }
+  }
+}
+
+
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain, RangeTask const & body)
+{
+  if(not count)
+    return;
+  grain = std::max<std::size_t>(grain, 1);
+  std::size_t const chunks = (count + grain - 1) / grain;
+  if(chunks == 1)
+  {
+    body(0, count);
+    return;
+  }
+
+  boost::shared_ptr<Range> range = boost::make_shared<Range>(count, grain, body);
+  std::size_t const helpers = std::min<std::size_t>(threadCount, chunks - 1);
+  for(std::size_t i = 0; i < helpers; ++i)
+    post(boost::bind(&ThreadPool::runChunks, range));
+
+  runChunks(range);
+
+  boost::unique_lock<boost::mutex> lock(range->mutex);
+  while(range->remainingChunks not_eq 0)
+    range->done.wait(lock);
+  if(range->error)
+    boost::rethrow_exception(range->error);
+}
+
+
+
+
+} // end of namespace uenf
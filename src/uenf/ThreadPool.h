@@ -0,0 +1,75 @@
+#ifndef UENF_THREADPOOL_H
+#define UENF_THREADPOOL_H
+
+
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <deque>
+#include <cstddef>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  A fixed set of worker threads processing posted tasks in FIFO order.
+
+  Besides fire-and-forget tasks via post(), the pool offers parallelFor(), which splits an index range into
+  chunks and blocks until all of them are processed. The calling thread works on chunks itself, so parallelFor()
+  can be nested and also works with a busy (or empty) pool. The first exception thrown by a chunk is rethrown
+  in the calling thread after all chunks are done:
+
+    ThreadPool::global().parallelFor(points.size(), 4096, boost::bind(&processRange, boost::ref(points), _1, _2));
+
+  Exceptions thrown by tasks given to post() are swallowed, as there is nobody to report them to.
+*/
+class ThreadPool : boost::noncopyable
+{
+public:
+  typedef boost::function<void ()> Task;
+  typedef boost::function<void (std::size_t begin, std::size_t end)> RangeTask;
+
+  //! zero threads means one per hardware thread
+  explicit ThreadPool(unsigned int threadCount = 0);
+  //! finishes all tasks already posted before returning
+  ~ThreadPool();
+
+  //! the process wide pool with one thread less than there are hardware threads (but at least one)
+  static ThreadPool & global();
+
+  void post(Task const & task);
+
+  //! calls body(begin, end) for consecutive chunks of at most grain indices covering [0, count)
+  void parallelFor(std::size_t count, std::size_t grain, RangeTask const & body);
+
+  unsigned int size() const { return threadCount; }
+
+private:
+  struct Range;
+  static void runChunks(boost::shared_ptr<Range> range);
+
+  void workerLoop();
+
+  unsigned int threadCount;
+  boost::mutex mutex;
+  boost::condition_variable wakeup;
+  std::deque<Task> tasks;
+  bool stopping;
+  boost::thread_group workers;
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
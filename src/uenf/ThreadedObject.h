@@ -3,13 +3,23 @@
 
 
 #include <uenf/Exceptions.h>
+#include <uenf/Log.h>
+#include <uenf/Trace.h>
+#include <uenf/Metrics.h>
 
 
 #include <boost/thread.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/exception/diagnostic_information.hpp>
 
+#include <deque>
 
-#pragma warning( disable : 4355)
+
+#ifdef _MSC_VER
+  #pragma warning( disable : 4355)
+#endif
 
 
   
@@ -23,6 +33,10 @@ namespace uenf
 	To use it, you just derive this class and overwrite the "void run()" method. If you want a
 	kind of "pause"-functionality, you could implement this in a derived class using a semaphore
 	or something comparable in a base class.
+
+	An exception leaving run() is not lost: it is captured (including the boost error_info of an
+	ExceptionBase) and can be fetched by the owner via takePendingException() or rethrown via
+	rethrowPendingException(). Exceptions nobody fetched are logged as errors upon destruction.
 */
 class ThreadedObject : boost::noncopyable
 {
@@ -43,12 +57,17 @@ private:
         thread->launchedThreadPtr = this;
       }
       thread->runBarrier.wait();
+      ++runningThreads();
       try
       {
+        UENF_TRACE_ZONE("ThreadedObject::run");
         thread->run();
       }
-      catch(...)  // TODO: more sophisticated exception handling here!
-      {}
+      catch(...)
+      {
+        thread->reportException(boost::current_exception());
+      }
+      --runningThreads();
       { 
         boost::lock_guard<boost::mutex> guard(thread->launchedThreadPtrMutex);
         thread->launchedThreadPtr = 0;
@@ -68,17 +87,19 @@ public:
 
 public:
   ThreadedObject():stop(false), launchedThreadPtr(0), runBarrier(2){}
-  ~ThreadedObject()
+  virtual ~ThreadedObject()
   {
     stopAndWaitForThreadToExit();
     {
       boost::lock_guard<boost::mutex> guard(threadMutex);
       thread.reset();
     }
+    logPendingExceptions();
   }
 
   void startThread()
   {
+    UENF_TRACE_ZONE("ThreadedObject::startThread");
     boost::lock_guard<boost::mutex> guard(threadMutex); // thread manipulation needs to be protected
     
     { // check, if thread is running (then the pointer is set) with scoped mutex locking
@@ -92,14 +113,17 @@ public:
     runBarrier.wait();  // we will not return, until the thread starts running
   }
 
-  void stopThread()
+  //! derived classes waiting for something in run() override this to also wake up their thread
+  virtual void stopThread()
   {
+    UENF_TRACE_INSTANT("ThreadedObject::stopThread");
     stop = true;  // we do not lock this access, as the variable is protected anyway and thus accessible by subclasses
   }
 
   void joinThread() 
   {
     // not reentrant this is! (and must be protected against access of thread variable)
+    UENF_TRACE_ZONE("ThreadedObject::joinThread");
     boost::lock_guard<boost::mutex> guard(threadMutex);
     if(thread) thread->join();
   }
@@ -119,6 +143,32 @@ public:
     joinThread();
   }
 
+
+  bool hasPendingException()
+  {
+    boost::lock_guard<boost::mutex> guard(pendingExceptionsMutex);
+    return not pendingExceptions.empty();
+  }
+
+  //! removes and returns the oldest captured exception, a null pointer if there is none
+  boost::exception_ptr takePendingException()
+  {
+    boost::lock_guard<boost::mutex> guard(pendingExceptionsMutex);
+    if(pendingExceptions.empty())
+      return boost::exception_ptr();
+    boost::exception_ptr e = pendingExceptions.front();
+    pendingExceptions.pop_front();
+    return e;
+  }
+
+  //! rethrows (and removes) the oldest captured exception in the calling thread, does nothing if there is none
+  void rethrowPendingException()
+  {
+    boost::exception_ptr e = takePendingException();
+    if(e)
+      boost::rethrow_exception(e);
+  }
+
 protected:
   /*! typical implementation is:
 		
@@ -138,6 +188,13 @@ protected:
   // used to stop thread endless loop from the outside
   volatile bool stop; 
 
+  //! Hands an exception captured in the thread over to the owner, see takePendingException().
+  virtual void reportException(boost::exception_ptr const & e)
+  {
+    boost::lock_guard<boost::mutex> guard(pendingExceptionsMutex);
+    pendingExceptions.push_back(e);
+  }
+
 private:
   // we need this pointer, because the LaunchedThread object in startThread is copied
   // by boost and thus needs to be set from inside the LaunchedThread object, see its
@@ -149,6 +206,29 @@ private:
   boost::mutex threadMutex;
   
   boost::barrier runBarrier;
+
+  // the completion channel for exceptions of the thread
+  std::deque<boost::exception_ptr> pendingExceptions;
+  boost::mutex pendingExceptionsMutex;
+
+  //! the number of ThreadedObjects currently inside run(), exported as a metric
+  static Metrics::Gauge & runningThreads()
+  {
+    static Metrics::Gauge & gauge = Metrics::Registry::global().gauge("uenf.threaded_objects.running");
+    return gauge;
+  }
+
+  void logPendingExceptions() // nothrow, as called in dtor
+  {
+    try
+    {
+      boost::exception_ptr e;
+      while((e = takePendingException()))
+        Log::log("ThreadedObject destroyed with unhandled exception:\n" + boost::diagnostic_information(e), Log::error);
+    }
+    catch(...)
+    {}
+  }
 };
 
 
@@ -0,0 +1,364 @@
+#include <uenf/TimerWheel.h>
+
+#include <boost/thread/locks.hpp>
+
+#include <algorithm>
+#include <ciso646>
+
+
+namespace uenf
+{
+
+
+
+boost::uint32_t const TimerWheel::none;
+boost::uint64_t const TimerWheel::never;
+
+
+
+TimerWheel::TimerWheel(Clock::duration resolution, Clock::duration coalescing):origin(Clock::now()),
+  resolutionNs(std::max<boost::int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(resolution).count())),
+  coalescingTicks(std::max<boost::int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(coalescing).count() /
+                                              resolutionNs)),
+  freeList(none), pendingCount(0), currentTick(0), plannedWakeup(0)
+{
+  for(int level = 0; level < levels; ++level)
+  {
+    std::fill(heads[level], heads[level] + slots, none);
+    std::fill(occupied[level], occupied[level] + slots / 64, 0);
+  }
+}
+
+
+
+TimerWheel::~TimerWheel()
+{
+  stopAndWaitForThreadToExit();
+}
+
+
+
+TimerWheel::TimerId TimerWheel::scheduleAt(Clock::time_point deadline, Callback callback, EventTarget * target)
+{
+  return add(nanosecondsOf(deadline), 0, std::move(callback), target);
+}
+
+
+
+TimerWheel::TimerId TimerWheel::schedulePeriodic(Clock::duration period, Callback callback, EventTarget * target)
+{
+  boost::int64_t const periodNs = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+  if(periodNs <= 0)
+    BOOST_THROW_EXCEPTION(ExceptionParameter(1));
+  return add(nanosecondsOf(Clock::now()) + periodNs, periodNs, std::move(callback), target);
+}
+
+
+
+bool TimerWheel::cancel(TimerId id)
+{
+  Callback callback; // destroyed after unlocking, its destructor might call back into the wheel
+  {
+    boost::lock_guard<boost::mutex> guard(mutex);
+    if(id.index >= entries.size() or entries[id.index].generation not_eq id.generation or
+       not entries[id.index].active)
+      return false;
+    unlink(id.index);
+    callback = std::move(entries[id.index].callback);
+    release(id.index);
+  }
+  return true;
+}
+
+
+
+std::size_t TimerWheel::pending() const
+{
+  boost::lock_guard<boost::mutex> guard(mutex);
+  return pendingCount;
+}
+
+
+
+void TimerWheel::stopThread()
+{
+  ThreadedObject::stopThread();
+  boost::lock_guard<boost::mutex> guard(mutex);
+  wakeup.notify_one();
+}
+
+
+
+void TimerWheel::run()
+{
+  std::vector<Firing> firings;
+  boost::unique_lock<boost::mutex> lock(mutex);
+  while(not stop)
+  {
+    boost::int64_t const now = nanosecondsOf(Clock::now());
+    advance(now < 0 ? 0 : boost::uint64_t(now / resolutionNs), now, firings);
+
+    if(not firings.empty())
+    {
+      lock.unlock();
+      for(std::size_t i = 0; i < firings.size(); ++i)
+      {
+        try
+        {
+          if(firings[i].target)
+            firings[i].target->postEvent(std::move(firings[i].callback));
+          else
+            firings[i].callback();
+        }
+        catch(...)
+        {
+          reportException(boost::current_exception());
+        }
+      }
+      firings.clear(); // destroys the callbacks outside the lock, too
+      lock.lock();
+      continue; // time went by while firing
+    }
+
+    boost::uint64_t next = nextEventTick();
+    if(next not_eq never)
+      next = (next + coalescingTicks - 1) / coalescingTicks * coalescingTicks;
+    plannedWakeup = next;
+    if(next == never)
+      wakeup.wait(lock);
+    else
+    {
+      boost::int64_t const waitNs = boost::int64_t(next) * resolutionNs - nanosecondsOf(Clock::now());
+      if(waitNs > 0)
+        wakeup.timed_wait(lock, boost::posix_time::microseconds((waitNs + 999) / 1000));
+    }
+    plannedWakeup = 0; // awake, no need to notify
+  }
+}
+
+
+
+boost::int64_t TimerWheel::nanosecondsOf(Clock::time_point t) const
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin).count();
+}
+
+
+
+TimerWheel::TimerId TimerWheel::add(boost::int64_t deadline, boost::int64_t period, Callback && callback,
+                                    EventTarget * target)
+{
+  if(callback.empty())
+    BOOST_THROW_EXCEPTION(ExceptionParameter(2));
+
+  boost::lock_guard<boost::mutex> guard(mutex);
+
+  boost::uint32_t index = freeList;
+  if(index not_eq none)
+    freeList = entries[index].next;
+  else
+  {
+    if(entries.size() >= none)
+      BOOST_THROW_EXCEPTION(ExceptionRuntime("TimerWheel: too many timers"));
+    index = boost::uint32_t(entries.size());
+    entries.push_back(Entry());
+  }
+
+  if(not pendingCount) // nothing to cascade, so the (maybe long idle) wheel can jump to the present
+  {
+    boost::int64_t const now = nanosecondsOf(Clock::now());
+    currentTick = std::max(currentTick, now < 0 ? 0 : boost::uint64_t(now / resolutionNs));
+  }
+
+  Entry & entry = entries[index];
+  entry.callback = std::move(callback);
+  entry.target = target;
+  entry.deadline = deadline;
+  entry.period = period;
+  entry.expiry = deadline <= 0 ? 0 : boost::uint64_t((deadline + resolutionNs - 1) / resolutionNs);
+  entry.active = true;
+  insert(index);
+  ++pendingCount;
+
+  wakeupIfEarlier(entry.expiry);
+  return TimerId(index, entry.generation);
+}
+
+
+
+void TimerWheel::insert(boost::uint32_t index)
+{
+  Entry & entry = entries[index];
+  entry.expiry = std::max(entry.expiry, currentTick);
+  boost::uint64_t const delta = entry.expiry - currentTick;
+
+  int level = 0;
+  while(level < levels - 1 and delta >= (boost::uint64_t(1) << (slotBits * (level + 1))))
+    ++level;
+  // beyond the range of the wheel: park in the top level, the cascade reinserts with the real expiry
+  boost::uint64_t const key = std::min(entry.expiry, currentTick + (boost::uint64_t(1) << (slotBits * levels)) - 1);
+  int const slot = int(key >> (slotBits * level)) & slotMask;
+
+  entry.level = (unsigned char)level;
+  entry.slot = (unsigned char)slot;
+  entry.prev = none;
+  entry.next = heads[level][slot];
+  if(entry.next not_eq none)
+    entries[entry.next].prev = index;
+  heads[level][slot] = index;
+  occupied[level][slot >> 6] |= boost::uint64_t(1) << (slot & 63);
+}
+
+
+
+void TimerWheel::unlink(boost::uint32_t index)
+{
+  Entry & entry = entries[index];
+  if(entry.prev not_eq none)
+    entries[entry.prev].next = entry.next;
+  else
+    heads[entry.level][entry.slot] = entry.next;
+  if(entry.next not_eq none)
+    entries[entry.next].prev = entry.prev;
+  if(heads[entry.level][entry.slot] == none)
+    occupied[entry.level][entry.slot >> 6] &= ~(boost::uint64_t(1) << (entry.slot & 63));
+}
+
+
+
+void TimerWheel::release(boost::uint32_t index)
+{
+  Entry & entry = entries[index];
+  entry.callback.reset();
+  entry.target = 0;
+  entry.active = false;
+  ++entry.generation;
+  entry.next = freeList;
+  freeList = index;
+  --pendingCount;
+}
+
+
+
+boost::uint32_t TimerWheel::takeSlot(int level, int slot)
+{
+  boost::uint32_t const list = heads[level][slot];
+  heads[level][slot] = none;
+  occupied[level][slot >> 6] &= ~(boost::uint64_t(1) << (slot & 63));
+  return list;
+}
+
+
+
+void TimerWheel::cascade()
+{
+  for(int level = 1; level < levels; ++level)
+  {
+    int const shift = slotBits * level;
+    if(currentTick & ((boost::uint64_t(1) << shift) - 1))
+      break;
+    boost::uint32_t index = takeSlot(level, int(currentTick >> shift) & slotMask);
+    while(index not_eq none)
+    {
+      boost::uint32_t const next = entries[index].next;
+      insert(index);
+      index = next;
+    }
+  }
+}
+
+
+
+void TimerWheel::expire(boost::int64_t now, std::vector<Firing> & firings)
+{
+  boost::uint32_t index = takeSlot(0, int(currentTick) & slotMask);
+  while(index not_eq none)
+  {
+    Entry & entry = entries[index];
+    boost::uint32_t const next = entry.next;
+
+    Firing firing;
+    firing.target = entry.target;
+    if(not entry.period)
+    {
+      firing.callback = std::move(entry.callback);
+      release(index);
+    }
+    else
+    {
+      firing.callback = entry.callback;
+      entry.deadline += entry.period;
+      if(entry.deadline <= now) // fell behind, skip the missed periods
+        entry.deadline += ((now - entry.deadline) / entry.period + 1) * entry.period;
+      entry.expiry = std::max(currentTick + 1, boost::uint64_t((entry.deadline + resolutionNs - 1) / resolutionNs));
+      insert(index);
+    }
+    firings.push_back(std::move(firing));
+    index = next;
+  }
+}
+
+
+
+void TimerWheel::advance(boost::uint64_t nowTick, boost::int64_t now, std::vector<Firing> & firings)
+{
+  while(currentTick <= nowTick)
+  {
+    cascade();
+    expire(now, firings);
+    ++currentTick;
+
+    // skip the ticks where nothing happens
+    boost::uint64_t const next = nextEventTick();
+    if(next > currentTick)
+      currentTick = std::min(next, nowTick + 1);
+  }
+}
+
+
+
+boost::uint64_t TimerWheel::nextEventTick() const
+{
+  if(not pendingCount)
+    return never;
+
+  // the next occupied slot of the lowest level until the end of its current round
+  int const first = int(currentTick) & slotMask;
+  for(int word = first >> 6; word < slots / 64; ++word)
+  {
+    boost::uint64_t bits = occupied[0][word];
+    if(word == first >> 6)
+      bits &= ~boost::uint64_t(0) << (first & 63);
+    if(bits)
+      return currentTick - first + word * 64 + __builtin_ctzll(bits);
+  }
+
+  // otherwise the next cascade of the lowest occupied level (timers of the lowest level expiring in its next round
+  // need the start of that round, too)
+  for(int level = 0; level < levels; ++level)
+  {
+    bool any = false;
+    for(int word = 0; word < slots / 64; ++word)
+      any = any or occupied[level][word];
+    if(any)
+    {
+      int const shift = slotBits * (level ? level : 1);
+      boost::uint64_t const mask = (boost::uint64_t(1) << shift) - 1;
+      return (currentTick + mask) & ~mask;
+    }
+  }
+  return never;
+}
+
+
+
+void TimerWheel::wakeupIfEarlier(boost::uint64_t tick)
+{
+  if(tick < plannedWakeup)
+    wakeup.notify_one();
+}
+
+
+
+
+} // end of namespace uenf
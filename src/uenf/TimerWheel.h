@@ -0,0 +1,166 @@
+#ifndef UENF_TIMERWHEEL_H
+#define UENF_TIMERWHEEL_H
+
+
+#include <uenf/ThreadedObject.h>
+#include <uenf/EventTarget.h>
+#include <uenf/SmallFunction.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <chrono>
+#include <vector>
+#include <cstddef>
+
+
+
+
+namespace uenf
+{
+
+
+
+
+/*!
+  A timer service: one thread fires any number of one-shot and periodic timers, instead of one ThreadedObject
+  per periodic job sleeping in its run() loop (which drifts by the duration of the work each round).
+
+    TimerWheel timers;
+    timers.startThread();
+
+    // on the timer thread, every 100 ms without drift
+    TimerWheel::TimerId id = timers.schedulePeriodic(std::chrono::milliseconds(100), [&]() { poll(); });
+
+    // on the thread of an EventLoop (any EventTarget), once
+    timers.scheduleOnce(std::chrono::seconds(2), [&]() { model.save(); }, &modelLoop);
+
+    timers.cancel(id);
+
+  The timers are kept in a hierarchical hashed timer wheel (4 levels of 256 slots, timers further away than
+  2^32 ticks are parked in the top level), so scheduling and cancelling are O(1) regardless of the number of
+  pending timers, and a tick costs time proportional to the timers expiring in it (plus an occasional cascade
+  of one slot into the level below). All timers expiring within one tick fire in one wakeup; a coalescing
+  window larger than the tick additionally delays wakeups to the end of the window they fall into, so timers
+  with nearby deadlines share a wakeup at the cost of firing up to one window late.
+
+  Periodic timers run at a fixed rate: the n-th deadline is the first one plus n periods, independent of when the
+  callbacks actually ran. If the service falls behind by more than a period, missed firings are skipped instead
+  of fired in a burst.
+
+  Callbacks running on the timer thread should be short, they delay all other timers. An exception thrown by
+  such a callback is kept for takePendingException() (see ThreadedObject), the timer itself stays scheduled.
+  A callback already due when cancel() is called may still run once.
+*/
+class TimerWheel : public ThreadedObject
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef SmallFunction<void ()> Callback;
+
+  //! identifies a scheduled timer, a default constructed id refers to none
+  class TimerId
+  {
+  public:
+    TimerId():index(0xffffffff), generation(0) {}
+    bool valid() const { return index not_eq 0xffffffff; }
+  private:
+    friend class TimerWheel;
+    TimerId(boost::uint32_t indexArg, boost::uint32_t generationArg):index(indexArg), generation(generationArg) {}
+    boost::uint32_t index;
+    boost::uint32_t generation;
+  };
+
+  /*! resolution is the tick of the wheel (deadlines are rounded up to it), coalescing the window wakeups are
+      rounded up to (zero or less than the resolution means no coalescing beyond the tick)
+  */
+  explicit TimerWheel(Clock::duration resolution = std::chrono::milliseconds(1),
+                      Clock::duration coalescing = Clock::duration::zero());
+  ~TimerWheel();
+
+  //! thread-safe, runs callback on the timer thread or, if given, posts it to target
+  TimerId scheduleAt(Clock::time_point deadline, Callback callback, EventTarget * target = 0);
+  TimerId scheduleOnce(Clock::duration delay, Callback callback, EventTarget * target = 0)
+  {
+    return scheduleAt(Clock::now() + delay, std::move(callback), target);
+  }
+
+  //! thread-safe, first firing after one period
+  TimerId schedulePeriodic(Clock::duration period, Callback callback, EventTarget * target = 0);
+
+  //! thread-safe, returns false if the timer already fired (one-shot) or was cancelled before
+  bool cancel(TimerId id);
+
+  std::size_t pending() const;
+
+  void stopThread();
+
+protected:
+  void run();
+
+private:
+  enum { levels = 4, slotBits = 8, slots = 1 << slotBits, slotMask = slots - 1 };
+  static boost::uint32_t const none = 0xffffffff;
+  static boost::uint64_t const never = ~boost::uint64_t(0);
+
+  struct Entry
+  {
+    Entry():target(0), deadline(0), period(0), expiry(0), next(none), prev(none), generation(0), level(0), slot(0),
+      active(false) {}
+    Callback callback;
+    EventTarget * target;
+    boost::int64_t deadline; // nanoseconds since origin
+    boost::int64_t period;   // nanoseconds, 0 for one-shot timers
+    boost::uint64_t expiry;  // tick
+    boost::uint32_t next, prev;
+    boost::uint32_t generation;
+    unsigned char level, slot;
+    bool active;
+  };
+
+  struct Firing
+  {
+    Callback callback;
+    EventTarget * target;
+  };
+
+  boost::int64_t nanosecondsOf(Clock::time_point t) const;
+  TimerId add(boost::int64_t deadline, boost::int64_t period, Callback && callback, EventTarget * target);
+
+  // all of the following need the mutex
+  void insert(boost::uint32_t index);
+  void unlink(boost::uint32_t index);
+  void release(boost::uint32_t index);
+  boost::uint32_t takeSlot(int level, int slot);
+  void cascade();
+  void expire(boost::int64_t now, std::vector<Firing> & firings);
+  void advance(boost::uint64_t nowTick, boost::int64_t now, std::vector<Firing> & firings);
+  boost::uint64_t nextEventTick() const;
+  void wakeupIfEarlier(boost::uint64_t tick);
+
+  Clock::time_point const origin;
+  boost::int64_t const resolutionNs;
+  boost::uint64_t const coalescingTicks;
+
+  mutable boost::mutex mutex;
+  boost::condition_variable wakeup;
+
+  std::vector<Entry> entries;
+  boost::uint32_t freeList;
+  std::size_t pendingCount;
+
+  boost::uint32_t heads[levels][slots];
+  boost::uint64_t occupied[levels][slots / 64];
+  boost::uint64_t currentTick;  // the next tick to process
+  boost::uint64_t plannedWakeup; // the tick the timer thread sleeps until
+};
+
+
+
+
+} // end of namespace uenf
+
+
+
+#endif
@@ -0,0 +1,582 @@
+
+
+
+#include <uenf/Trace.h>
+#include <uenf/ThreadedObject.h>
+#include <uenf/Exceptions.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define UENF_TRACE_HAS_TSC
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <ciso646>
+
+
+// The binary format (all numbers in the byte order of the recording machine):
+//
+//   file    := "UENFTRC1" f64:nanosecondsPerTick record*
+//   record  := u8:'N' u32:nameId u16:length char[length]               definition of a name before first use
+//            | u8:'T' u32:threadId u16:length char[length]             name of a thread
+//            | u8:type u32:threadId u64:ticks u32:nameId [f64:value]   an event, type is one of B, E, i, C,
+//                                                                      only C carries the value
+//
+// ticks are relative to the start of the trace.
+
+
+namespace uenf
+{
+
+namespace Trace
+{
+
+
+namespace detail
+{
+  boost::atomic<bool> enabled(false);
+}
+
+
+namespace
+{
+
+  inline boost::uint64_t ticks()
+  {
+#ifdef UENF_TRACE_HAS_TSC
+    return __rdtsc();
+#else
+    return boost::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+
+
+
+  struct Event
+  {
+    boost::uint64_t ticks;
+    char const * name;
+    double value;
+    char type;
+  };
+
+
+
+  //! single producer (the recording thread), single consumer (the flusher) ring
+  struct ThreadRing : boost::noncopyable
+  {
+    ThreadRing(std::size_t capacity, boost::uint32_t threadIdArg):events(capacity), mask(capacity - 1), head(0),
+      tail(0), threadId(threadIdArg), threadName(0), threadNameWritten(false), exited(false), dropped(0) {}
+
+    void push(char type, char const * name, double value)
+    {
+      boost::uint64_t const h = head.load(boost::memory_order_relaxed);
+      if(h - tail.load(boost::memory_order_acquire) > mask)
+      {
+        dropped.fetch_add(1, boost::memory_order_relaxed);
+        return;
+      }
+      Event & e = events[h & mask];
+      e.ticks = ticks();
+      e.name = name;
+      e.value = value;
+      e.type = type;
+      head.store(h + 1, boost::memory_order_release);
+    }
+
+    std::vector<Event> events;
+    boost::uint64_t const mask;
+    boost::atomic<boost::uint64_t> head;
+    boost::atomic<boost::uint64_t> tail;
+    boost::uint32_t const threadId;
+    boost::atomic<char const *> threadName;
+    bool threadNameWritten;          // only touched by the flusher
+    boost::atomic<bool> exited;
+    boost::atomic<std::size_t> dropped;
+  };
+
+
+
+  /* all rings of living threads (and of exited ones, until flushed), a wanted leak like the logger list in Log.cpp;
+     while a flusher runs, only the flusher deletes rings, otherwise a thread deletes its own ring upon exit
+  */
+  struct Registry
+  {
+    Registry():nextThreadId(1), ringCapacity(1 << 14), flushing(false) {}
+    boost::mutex mutex;
+    std::vector<ThreadRing *> rings;
+    boost::uint32_t nextThreadId;
+    std::size_t ringCapacity;
+    bool flushing;
+  };
+
+  Registry & getRegistry()
+  {
+    static Registry * registryPtr = new Registry;
+    return *registryPtr;
+  }
+
+  //! needs the registry mutex
+  void deleteExitedRings(Registry & registry)
+  {
+    for(std::size_t i = 0; i < registry.rings.size(); )
+    {
+      if(registry.rings[i]->exited.load())
+      {
+        delete registry.rings[i];
+        registry.rings.erase(registry.rings.begin() + i);
+      }
+      else
+        ++i;
+    }
+  }
+
+
+
+  /* the fast path only touches this trivial thread local, the holder marks the ring upon thread exit (for the
+     flusher to write its last events and delete it) or deletes it right away, if no flusher runs
+  */
+  thread_local ThreadRing * currentRing = 0;
+  // set by setThreadName() before the thread has a ring, which is only allocated by its first event
+  thread_local char const * pendingThreadName = 0;
+
+  struct RingHolder
+  {
+    RingHolder():ring(0) {}
+    ~RingHolder()
+    {
+      currentRing = 0;
+      if(not ring)
+        return;
+      Registry & registry = getRegistry();
+      boost::unique_lock<boost::mutex> guard(registry.mutex);
+      ring->exited = true;
+      if(not registry.flushing)
+        deleteExitedRings(registry);
+    }
+    ThreadRing * ring;
+  };
+
+  thread_local RingHolder ringHolder;
+
+
+  ThreadRing * registerThread()
+  {
+    Registry & registry = getRegistry();
+    try
+    {
+      boost::unique_lock<boost::mutex> guard(registry.mutex);
+      ThreadRing * ring = new ThreadRing(registry.ringCapacity, registry.nextThreadId++);
+      ring->threadName = pendingThreadName;
+      registry.rings.push_back(ring);
+      ringHolder.ring = ring;
+      currentRing = ring;
+      return ring;
+    }
+    catch(...) // no memory, no trace of this thread (recording must not throw)
+    {
+      return 0;
+    }
+  }
+
+
+
+
+
+  class Sink
+  {
+  public:
+    virtual ~Sink() {}
+    virtual void threadName(boost::uint32_t threadId, char const * name) = 0;
+    virtual void event(boost::uint32_t threadId, Event const & e, boost::uint64_t relativeTicks) = 0;
+    virtual void finish() = 0;
+  };
+
+
+
+  class ChromeJsonSink : public Sink
+  {
+  public:
+    ChromeJsonSink(std::ofstream & fileArg, double nanosecondsPerTickArg):file(fileArg),
+      nanosecondsPerTick(nanosecondsPerTickArg), first(true)
+    {
+      file.precision(15); // of the counter values, the default of 6 digits would round larger counts
+      file << "{\"traceEvents\":[\n";
+    }
+
+    void threadName(boost::uint32_t threadId, char const * name)
+    {
+      separate();
+      file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"name\":";
+      writeString(name);
+      file << "}}";
+    }
+
+    void event(boost::uint32_t threadId, Event const & e, boost::uint64_t relativeTicks)
+    {
+      separate();
+      file << "{\"name\":";
+      writeString(e.name);
+      // microseconds with three exact decimals, written from integer nanoseconds
+      boost::uint64_t const ns = boost::uint64_t(double(relativeTicks) * nanosecondsPerTick + 0.5);
+      file << ",\"ph\":\"" << e.type << "\",\"ts\":" << ns / 1000 << '.' << std::setw(3) << std::setfill('0')
+           << ns % 1000 << ",\"pid\":1,\"tid\":" << threadId;
+      if(e.type == detail::instantEvent)
+        file << ",\"s\":\"t\"";
+      else if(e.type == detail::counterEvent)
+        file << ",\"args\":{\"value\":" << e.value << '}';
+      file << '}';
+    }
+
+    void finish()
+    {
+      file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+  private:
+    void separate()
+    {
+      if(not first)
+        file << ",\n";
+      first = false;
+    }
+
+    void writeString(char const * s)
+    {
+      file << '"';
+      for(; *s; ++s)
+      {
+        if(*s == '"' or *s == '\\')
+          file << '\\' << *s;
+        else if((unsigned char)(*s) < 0x20)
+          file << ' ';
+        else
+          file << *s;
+      }
+      file << '"';
+    }
+
+    std::ofstream & file;
+    double const nanosecondsPerTick;
+    bool first;
+  };
+
+
+
+  class BinarySink : public Sink
+  {
+  public:
+    BinarySink(std::ofstream & fileArg, double nanosecondsPerTick):file(fileArg)
+    {
+      file.write("UENFTRC1", 8);
+      put(nanosecondsPerTick);
+    }
+
+    void threadName(boost::uint32_t threadId, char const * name)
+    {
+      putText('T', threadId, name);
+    }
+
+    void event(boost::uint32_t threadId, Event const & e, boost::uint64_t relativeTicks)
+    {
+      boost::uint32_t const id = nameId(e.name);
+      put(e.type);
+      put(threadId);
+      put(relativeTicks);
+      put(id);
+      if(e.type == detail::counterEvent)
+        put(e.value);
+    }
+
+    void finish()
+    {
+      file.flush();
+    }
+
+  private:
+    template<typename T> void put(T const & value)
+    {
+      file.write(reinterpret_cast<char const *>(&value), sizeof(T));
+    }
+
+    void putText(char type, boost::uint32_t id, char const * text)
+    {
+      std::string const s(text);
+      boost::uint16_t const length = boost::uint16_t(std::min<std::size_t>(s.size(), 0xffff));
+      put(type);
+      put(id);
+      put(length);
+      file.write(s.data(), length);
+    }
+
+    boost::uint32_t nameId(char const * name)
+    {
+      std::map<char const *, boost::uint32_t>::const_iterator it = names.find(name);
+      if(it not_eq names.end())
+        return it->second;
+      boost::uint32_t const id = boost::uint32_t(names.size());
+      names[name] = id;
+      putText('N', id, name);
+      return id;
+    }
+
+    std::ofstream & file;
+    std::map<char const *, boost::uint32_t> names; // by address, names are expected to be literals
+  };
+
+
+
+
+
+
+  //! drains the rings of all threads periodically into the sink
+  class Flusher : public ThreadedObject
+  {
+  public:
+    Flusher(std::string const & fileName, Format format, int intervalArg, boost::uint64_t startTicksArg,
+            double nanosecondsPerTick):
+      file(fileName.c_str(), format == binary ? std::ios::out | std::ios::binary : std::ios::out),
+      interval(intervalArg), startTicks(startTicksArg)
+    {
+      if(not file)
+        BOOST_THROW_EXCEPTION(ExceptionIO(ExceptionIO::open, fileName));
+      if(format == binary)
+        sink.reset(new BinarySink(file, nanosecondsPerTick));
+      else
+        sink.reset(new ChromeJsonSink(file, nanosecondsPerTick));
+    }
+
+    ~Flusher()
+    {
+      stopAndWaitForThreadToExit();
+    }
+
+    void finish()
+    {
+      sink->finish();
+      file.close();
+    }
+
+  protected:
+    void run()
+    {
+      while(not stop)
+      {
+        drain();
+        mSleep(interval);
+      }
+      drain();
+    }
+
+  private:
+    /*! The registry mutex is only held to take a snapshot of the rings and to delete the exited ones afterwards,
+        not while writing, as a thread recording its first event needs it to register. The rings themselves are
+        single consumer, so reading them needs no lock, and no one else deletes them while the flusher runs.
+    */
+    void drain()
+    {
+      Registry & registry = getRegistry();
+      {
+        boost::unique_lock<boost::mutex> guard(registry.mutex);
+        snapshot.assign(registry.rings.begin(), registry.rings.end());
+      }
+
+      bool anyExited = false;
+      for(std::size_t i = 0; i < snapshot.size(); ++i)
+      {
+        ThreadRing * ring = snapshot[i];
+        // before draining, to not lose events, the ring is deleted below only if this was already set
+        bool const exited = ring->exited.load(boost::memory_order_acquire);
+
+        char const * name = ring->threadName.load();
+        if(name and not ring->threadNameWritten)
+        {
+          sink->threadName(ring->threadId, name);
+          ring->threadNameWritten = true;
+        }
+
+        boost::uint64_t t = ring->tail.load(boost::memory_order_relaxed);
+        boost::uint64_t const h = ring->head.load(boost::memory_order_acquire);
+        for(; t not_eq h; ++t)
+        {
+          Event const & e = ring->events[t & ring->mask];
+          // events recorded before the start (a zone ending after a restart) are clamped to the start
+          sink->event(ring->threadId, e, e.ticks > startTicks ? e.ticks - startTicks : 0);
+        }
+        ring->tail.store(h, boost::memory_order_release);
+
+        if(not exited)
+          snapshot[i] = 0;
+        else
+          anyExited = true;
+      }
+
+      if(anyExited)
+      {
+        boost::unique_lock<boost::mutex> guard(registry.mutex);
+        for(std::size_t i = 0; i < snapshot.size(); ++i)
+          if(snapshot[i])
+          {
+            registry.rings.erase(std::find(registry.rings.begin(), registry.rings.end(), snapshot[i]));
+            delete snapshot[i];
+          }
+      }
+    }
+
+    std::ofstream file;
+    boost::scoped_ptr<Sink> sink;
+    std::vector<ThreadRing *> snapshot; // of the rings, drained ones which had exited before are kept
+    int const interval;
+    boost::uint64_t const startTicks;
+  };
+
+
+
+  //! the running flusher, only touched by start() and stop() (serialized by their mutex)
+  boost::scoped_ptr<Flusher> * getFlusher()
+  {
+    static boost::scoped_ptr<Flusher> * flusherPtr = new boost::scoped_ptr<Flusher>;
+    return flusherPtr;
+  }
+
+  boost::mutex * getStartStopMutex()
+  {
+    static boost::mutex * mutexPtr = new boost::mutex;
+    return mutexPtr;
+  }
+
+
+
+  double calibrateNanosecondsPerTick()
+  {
+#ifdef UENF_TRACE_HAS_TSC
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+    boost::uint64_t const startTicks = ticks();
+    std::chrono::steady_clock::time_point now;
+    do
+    {
+      now = std::chrono::steady_clock::now();
+    }
+    while(now - start < std::chrono::milliseconds(10));
+    boost::uint64_t const elapsedTicks = ticks() - startTicks;
+    return std::chrono::duration<double, std::nano>(now - start).count() / double(elapsedTicks ? elapsedTicks : 1);
+#else
+    return 1.0;
+#endif
+  }
+
+}  // end of anonymous namespace
+
+
+
+
+
+
+void start(std::string const & fileName, Format format, int flushIntervalMs, std::size_t ringEvents)
+{
+  boost::unique_lock<boost::mutex> guard(*getStartStopMutex());
+  if(*getFlusher())
+    BOOST_THROW_EXCEPTION(ExceptionCode("Trace::start called while tracing is running"));
+
+  double const nanosecondsPerTick = calibrateNanosecondsPerTick();
+
+  Registry & registry = getRegistry();
+  {
+    boost::unique_lock<boost::mutex> registryGuard(registry.mutex);
+    std::size_t capacity = 2;
+    while(capacity < ringEvents)
+      capacity *= 2;
+    registry.ringCapacity = capacity;
+    // forget whatever was recorded while tracing was off
+    deleteExitedRings(registry);
+    for(std::size_t i = 0; i < registry.rings.size(); ++i)
+    {
+      ThreadRing * ring = registry.rings[i];
+      ring->tail.store(ring->head.load());
+      ring->dropped = 0;
+      ring->threadNameWritten = false;
+    }
+  }
+
+  getFlusher()->reset(new Flusher(fileName, format, flushIntervalMs, ticks(), nanosecondsPerTick));
+  {
+    boost::unique_lock<boost::mutex> registryGuard(registry.mutex);
+    registry.flushing = true;
+  }
+  (*getFlusher())->startThread();
+  detail::enabled = true;
+}
+
+
+
+void stop()
+{
+  boost::unique_lock<boost::mutex> guard(*getStartStopMutex());
+  if(not *getFlusher())
+    return;
+  detail::enabled = false;
+  (*getFlusher())->stopAndWaitForThreadToExit();
+  (*getFlusher())->finish();
+  getFlusher()->reset();
+
+  Registry & registry = getRegistry();
+  boost::unique_lock<boost::mutex> registryGuard(registry.mutex);
+  registry.flushing = false;
+  deleteExitedRings(registry); // of threads which exited after the last drain
+}
+
+
+
+void setThreadName(char const * name)
+{
+  pendingThreadName = name;
+  if(currentRing)
+    currentRing->threadName = name;
+}
+
+
+
+std::size_t droppedEvents()
+{
+  Registry & registry = getRegistry();
+  boost::unique_lock<boost::mutex> guard(registry.mutex);
+  std::size_t dropped = 0;
+  for(std::size_t i = 0; i < registry.rings.size(); ++i)
+    dropped += registry.rings[i]->dropped.load();
+  return dropped;
+}
+
+
+
+namespace detail
+{
+
+void record(EventType type, char const * name, double value)
+{
+  ThreadRing * ring = currentRing;
+  if(not ring)
+  {
+    ring = registerThread();
+    if(not ring)
+      return;
+  }
+  ring->push(char(type), name, value);
+}
+
+}  // end of namespace detail
+
+
+
+}  // end of namespace Trace
+
+}  // end of namespace uenf